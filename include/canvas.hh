@@ -0,0 +1,44 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+struct Colour {
+  uint8_t r, g, b, a;
+};
+
+// Something the Mandelbrot class can draw into
+class Canvas {
+public:
+  virtual ~Canvas() {}
+
+  // Fill a size x size block with a colour	*** Called from worker threads ***
+  virtual void Draw_pixel(int32_t x, int32_t y, int32_t size, uint8_t r, uint8_t g, uint8_t b, uint8_t a) = 0;
+
+  // Draw n pixels of a row starting at x, y
+  virtual void Draw_row(int32_t x, int32_t y, int32_t n, const Colour* colours) {
+    for (int32_t i = 0; i < n; i++)
+      Draw_pixel(x + i, y, 1, colours[i].r, colours[i].g, colours[i].b, colours[i].a);
+  }
+
+  virtual const int32_t width(void) const = 0;
+  virtual const int32_t height(void) const = 0;
+
+};
@@ -0,0 +1,163 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <complex>
+#include <ostream>
+#include "simd.hh"
+
+template <typename T>
+constexpr T sqr(T val) { return val * val; }
+
+// Pack of N complex numbers, stored as a vector of reals and a vector of imaginaries
+
+template <typename T, unsigned N>
+class complexpack {
+public:
+  typedef simd<T, N> ops;
+  typedef typename ops::vec vec;
+  typedef typename ops::mask mask;
+  static const unsigned lanes = N;
+
+private:
+  vec _reals, _imags;
+
+public:
+  complexpack(vec re, vec im) :
+    _reals(re), _imags(im)
+  {}
+
+  complexpack() :
+    _reals(ops::set1(0)),
+    _imags(ops::set1(0))
+  {}
+
+  // The same number in every lane
+  explicit complexpack(std::complex<T> c) :
+    _reals(ops::set1(c.real())),
+    _imags(ops::set1(c.imag()))
+  {}
+
+  std::complex<T> get(unsigned i) const { return std::complex<T>(ops::get(_reals, i), ops::get(_imags, i)); }
+
+  void set(unsigned i, T re = 0, T im = 0) {
+    ops::set(_reals, i, re);
+    ops::set(_imags, i, im);
+  }
+
+  void set(unsigned i, std::complex<float> c) {
+    ops::set(_reals, i, (T)c.real());
+    ops::set(_imags, i, (T)c.imag());
+  }
+
+  void set(unsigned i, std::complex<double> c) {
+    ops::set(_reals, i, (T)c.real());
+    ops::set(_imags, i, (T)c.imag());
+  }
+
+  T real(unsigned i) const { return ops::get(_reals, i); }
+  T imag(unsigned i) const { return ops::get(_imags, i); }
+
+  const vec& reals(void) const { return _reals; }
+  const vec& imags(void) const { return _imags; }
+
+  complexpack& operator +=(const complexpack& other) {
+    _reals = ops::add(_reals, other._reals);
+    _imags = ops::add(_imags, other._imags);
+    return *this;
+  }
+
+  complexpack& operator -=(const complexpack& other) {
+    _reals = ops::sub(_reals, other._reals);
+    _imags = ops::sub(_imags, other._imags);
+    return *this;
+  }
+
+  complexpack& operator *=(const complexpack& other) {
+    *this = *this * other;
+    return *this;
+  }
+
+  complexpack& operator /=(const complexpack& other) {
+    *this = *this / other;
+    return *this;
+  }
+
+  friend complexpack operator +(const complexpack& a) {
+    return a;
+  }
+
+  friend complexpack operator +(const complexpack& a, const complexpack& b) {
+    return complexpack(ops::add(a._reals, b._reals), ops::add(a._imags, b._imags));
+  }
+
+  friend complexpack operator -(const complexpack& a, const complexpack& b) {
+    return complexpack(ops::sub(a._reals, b._reals), ops::sub(a._imags, b._imags));
+  }
+
+  friend complexpack operator *(const complexpack& a, const complexpack& b) {
+    vec re = ops::msub(a._imags, b._imags, ops::mul(a._reals, b._reals));	// ac - bd
+    vec im = ops::madd(a._reals, b._imags, ops::mul(a._imags, b._reals));	// bc + ad
+    return complexpack(re, im);
+  }
+
+  friend complexpack operator /(const complexpack& a, const complexpack& b) {
+    vec den = ops::madd(b._imags, b._imags, ops::mul(b._reals, b._reals));
+    vec re_num = ops::madd(a._imags, b._imags, ops::mul(a._reals, b._reals));
+    vec im_num = ops::msub(a._reals, b._imags, ops::mul(a._imags, b._reals));
+    return complexpack(ops::div(re_num, den), ops::div(im_num, den));
+  }
+
+  // z^2 with three multiplies instead of four
+  friend complexpack sqr(const complexpack& a) {
+    vec re = ops::msub(a._imags, a._imags, ops::mul(a._reals, a._reals));
+    vec ri = ops::mul(a._reals, a._imags);
+    return complexpack(re, ops::add(ri, ri));
+  }
+
+  friend mask operator ==(const complexpack& a, const complexpack& b) {
+    return ops::mand(ops::cmpeq(a._reals, b._reals), ops::cmpeq(a._imags, b._imags));
+  }
+
+  friend mask operator !=(const complexpack& a, const complexpack& b) {
+    return ops::mnot(a == b);
+  }
+
+  friend vec norm(const complexpack& a) {
+    return ops::madd(a._imags, a._imags, ops::mul(a._reals, a._reals));
+  }
+
+  friend std::ostream& operator <<(std::ostream& os, const complexpack& c) {
+    os << "{ ";
+    for (unsigned i = 0; i < N; i++) {
+      if (i > 0)
+	os << ", ";
+      os << c.real(i);
+      if (c.imag(i) < 0)
+	os << " - ";
+      else
+	os << " + ";
+      os << std::abs(c.imag(i)) << "i";
+    }
+    os << " }";
+
+    return os;
+  }
+
+};
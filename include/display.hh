@@ -18,9 +18,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
 #include <SDL2/SDL.h>
+#include "canvas.hh"
+#include "relaxed.hh"
 
-class Display {
+class Display : public Canvas {
 private:
   SDL_Window *_window;
   SDL_Renderer *_renderer;
@@ -29,17 +33,30 @@ private:
   // Screen dimension constants
   const int32_t _screen_width = 960, _screen_height = 544;
 
+  // Worker threads draw into this copy of the screen, and Refresh() uploads the bands of rows that changed
+  // by way of _upload, since SDL needs them in plain memory that no thread is writing
+  std::vector<Relaxed<uint32_t>> _pixels;
+  std::vector<uint32_t> _upload;
+  static const int32_t _band_height = 16;
+  std::vector<std::atomic<bool>> _dirty;
+
   uint32_t _last_redraw;
 
+  void _mark_dirty(int32_t y0, int32_t y1);
+
 public:
   Display();
   ~Display();
 
   void Draw_pixel(int32_t x, int32_t y, int32_t size, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+  void Draw_row(int32_t x, int32_t y, int32_t n, const Colour* colours);
 
   // Refresh contents of window	*** Only in the main thread ***
   int Refresh(void);
 
+  // SDL_GetTicks() when the window was last presented
+  uint32_t Last_refresh(void) const { return _last_redraw; }
+
   const int32_t width(void) const { return _screen_width; }
   const int32_t height(void) const { return _screen_height; }
 
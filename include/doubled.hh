@@ -0,0 +1,267 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include "simd.hh"
+
+// Error-free transformations, the building blocks of the extended precision types
+
+// s + e == a + b exactly
+template <typename T>
+inline T two_sum(T a, T b, T& e) {
+  T s = a + b;
+  T bb = s - a;
+  e = (a - (s - bb)) + (b - bb);
+  return s;
+}
+
+// The same, when |a| >= |b|
+template <typename T>
+inline T quick_two_sum(T a, T b, T& e) {
+  T s = a + b;
+  e = b - (s - a);
+  return s;
+}
+
+// p + e == a * b exactly
+inline float two_prod(float a, float b, float& e) {
+  float p = a * b;
+#ifdef __FP_FAST_FMAF
+  e = std::fma(a, b, -p);
+#else
+  // Dekker's product, splitting each factor into halves whose products are exact
+  const float split = 4097.0f;	// 2^12 + 1
+  float t = split * a, a_hi = t - (t - a), a_lo = a - a_hi;
+  t = split * b;
+  float b_hi = t - (t - b), b_lo = b - b_hi;
+  e = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+  return p;
+}
+
+inline double two_prod(double a, double b, double& e) {
+  double p = a * b;
+#ifdef __FP_FAST_FMA
+  e = std::fma(a, b, -p);
+#else
+  const double split = 134217729.0;	// 2^27 + 1
+  double t = split * a, a_hi = t - (t - a), a_lo = a - a_hi;
+  t = split * b;
+  double b_hi = t - (t - b), b_lo = b - b_hi;
+  e = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+  return p;
+}
+
+// Unevaluated sum of two T's, for about twice the mantissa bits of T
+// doubled<double> is "double-double" and doubled<float> is "float-float"
+
+template <typename T>
+class doubled {
+public:
+  T hi, lo;
+
+  doubled() :
+    hi(0), lo(0)
+  {}
+
+  doubled(double d) :
+    hi(d), lo(d - (double)hi)
+  {}
+
+  doubled(T h, T l) :
+    hi(h), lo(l)
+  {}
+
+  explicit operator double() const { return (double)hi + (double)lo; }
+
+  friend doubled operator -(const doubled& a) {
+    return doubled(-a.hi, -a.lo);
+  }
+
+  friend doubled operator +(const doubled& a, const doubled& b) {
+    T e, f;
+    T s = two_sum(a.hi, b.hi, e);
+    T t = two_sum(a.lo, b.lo, f);
+    e += t;
+    s = quick_two_sum(s, e, e);
+    e += f;
+    s = quick_two_sum(s, e, e);
+    return doubled(s, e);
+  }
+
+  friend doubled operator -(const doubled& a, const doubled& b) {
+    return a + -b;
+  }
+
+  friend doubled operator *(const doubled& a, const doubled& b) {
+    T e;
+    T p = two_prod(a.hi, b.hi, e);
+    e += a.hi * b.lo + a.lo * b.hi;
+    p = quick_two_sum(p, e, e);
+    return doubled(p, e);
+  }
+
+  friend doubled operator /(const doubled& a, const doubled& b) {
+    T q1 = a.hi / b.hi;
+    doubled r = a - b * doubled(q1, 0);
+    T q2 = r.hi / b.hi;
+    r = r - b * doubled(q2, 0);
+    T q3 = r.hi / b.hi;
+    T e;
+    q1 = quick_two_sum(q1, q2, e);
+    return doubled(q1, e) + doubled(q3, 0);
+  }
+
+  friend bool operator >=(const doubled& a, const doubled& b) {
+    return (a.hi > b.hi) || ((a.hi == b.hi) && (a.lo >= b.lo));
+  }
+
+  friend bool operator ==(const doubled& a, const doubled& b) {
+    return (a.hi == b.hi) && (a.lo == b.lo);
+  }
+
+};
+
+typedef doubled<double> ddouble;
+typedef doubled<float> ffloat;
+
+// Vectors of doubled<T>, kept as a vector of the high parts and a vector of the low parts,
+// so float-float gets as many lanes as float does
+
+template <typename T, unsigned N>
+struct simd_doubled {
+  typedef simd<T, N> ops;
+  typedef typename ops::vec part;
+  struct vec {
+    part hi, lo;
+  };
+  typedef typename ops::mask mask;
+  static const bool fused = false;
+
+private:
+  static part _two_sum(part a, part b, part& e) {
+    part s = ops::add(a, b);
+    part bb = ops::sub(s, a);
+    e = ops::add(ops::sub(a, ops::sub(s, bb)), ops::sub(b, bb));
+    return s;
+  }
+
+  static part _quick_two_sum(part a, part b, part& e) {
+    part s = ops::add(a, b);
+    e = ops::sub(b, ops::sub(s, a));
+    return s;
+  }
+
+  static part _split(part a, part& lo) {
+    // 2^12 + 1 or 2^27 + 1
+    const part split = ops::set1((T)((1 << ((std::numeric_limits<T>::digits + 1) / 2)) + 1));
+    part t = ops::mul(split, a);
+    part hi = ops::sub(t, ops::sub(t, a));
+    lo = ops::sub(a, hi);
+    return hi;
+  }
+
+  static part _two_prod(part a, part b, part& e) {
+    part p = ops::mul(a, b);
+    if (ops::fused) {
+      // a * b - p, rounded once
+      e = ops::madd(a, b, ops::sub(ops::set1(0), p));
+    } else {
+      part a_lo, b_lo;
+      part a_hi = _split(a, a_lo), b_hi = _split(b, b_lo);
+      e = ops::sub(ops::mul(a_hi, b_hi), p);
+      e = ops::add(e, ops::mul(a_hi, b_lo));
+      e = ops::add(e, ops::mul(a_lo, b_hi));
+      e = ops::add(e, ops::mul(a_lo, b_lo));
+    }
+    return p;
+  }
+
+public:
+  static vec set1(doubled<T> a) { return vec{ ops::set1(a.hi), ops::set1(a.lo) }; }
+
+  static vec add(vec a, vec b) {
+    part e, f;
+    part s = _two_sum(a.hi, b.hi, e);
+    part t = _two_sum(a.lo, b.lo, f);
+    e = ops::add(e, t);
+    s = _quick_two_sum(s, e, e);
+    e = ops::add(e, f);
+    s = _quick_two_sum(s, e, e);
+    return vec{ s, e };
+  }
+
+  static vec sub(vec a, vec b) {
+    part zero = ops::set1(0);
+    return add(a, vec{ ops::sub(zero, b.hi), ops::sub(zero, b.lo) });
+  }
+
+  static vec mul(vec a, vec b) {
+    part e;
+    part p = _two_prod(a.hi, b.hi, e);
+    e = ops::madd(a.hi, b.lo, e);
+    e = ops::madd(a.lo, b.hi, e);
+    p = _quick_two_sum(p, e, e);
+    return vec{ p, e };
+  }
+
+  static vec div(vec a, vec b) {
+    part q1 = ops::div(a.hi, b.hi);
+    vec r = sub(a, mul(b, vec{ q1, ops::set1(0) }));
+    part q2 = ops::div(r.hi, b.hi);
+    r = sub(r, mul(b, vec{ q2, ops::set1(0) }));
+    part q3 = ops::div(r.hi, b.hi);
+    part e;
+    q1 = _quick_two_sum(q1, q2, e);
+    return add(vec{ q1, e }, vec{ q3, ops::set1(0) });
+  }
+
+  static vec madd(vec a, vec b, vec c) { return add(mul(a, b), c); }
+  static vec msub(vec a, vec b, vec c) { return sub(c, mul(a, b)); }
+
+  static mask cmpge(vec a, vec b) {
+    return ops::mor(ops::mnot(ops::cmpge(b.hi, a.hi)),
+		    ops::mand(ops::cmpeq(a.hi, b.hi), ops::cmpge(a.lo, b.lo)));
+  }
+
+  static mask cmpeq(vec a, vec b) { return ops::mand(ops::cmpeq(a.hi, b.hi), ops::cmpeq(a.lo, b.lo)); }
+
+  static mask mand(mask a, mask b) { return ops::mand(a, b); }
+  static mask mor(mask a, mask b) { return ops::mor(a, b); }
+  static mask mnot(mask a) { return ops::mnot(a); }
+  static vec select(mask m, vec a, vec b) { return vec{ ops::select(m, a.hi, b.hi), ops::select(m, a.lo, b.lo) }; }
+
+  static uint32_t bits(mask m) { return ops::bits(m); }
+
+  static doubled<T> get(const vec& v, unsigned i) { return doubled<T>(ops::get(v.hi, i), ops::get(v.lo, i)); }
+
+  static void set(vec& v, unsigned i, doubled<T> a) {
+    ops::set(v.hi, i, a.hi);
+    ops::set(v.lo, i, a.lo);
+  }
+};
+
+template <typename T, unsigned N>
+struct simd<doubled<T>, N> : simd_doubled<T, N> {};
+
+template <typename T>
+struct simd<doubled<T>, 1> : simd_doubled<T, 1> {};
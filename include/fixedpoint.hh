@@ -0,0 +1,79 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <complex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Arbitrary precision fixed-point number in two's complement
+// The last limb is the signed integer part, the others are the fraction, least significant first
+
+class fixedpoint {
+private:
+  std::vector<uint32_t> _limbs;
+
+  void _negate(void);
+
+public:
+  fixedpoint(double d = 0, unsigned limbs = 2);
+
+  // Parse a decimal number such as "-0.7436438870371587047521915061" or "1.5e-3", 0 if s isn't one
+  fixedpoint(const std::string& s, unsigned limbs);
+
+  // Whether s is a number the constructor above can parse
+  static bool valid(const std::string& s);
+
+  unsigned limbs(void) const { return _limbs.size(); }
+
+  // Change the precision by adding or dropping fraction limbs
+  void set_limbs(unsigned limbs);
+
+  bool negative(void) const { return (int32_t)_limbs.back() < 0; }
+
+  double to_double(void) const;
+
+  fixedpoint& operator +=(const fixedpoint& other);
+  fixedpoint& operator -=(const fixedpoint& other);
+
+  friend fixedpoint operator -(const fixedpoint& a);
+  friend fixedpoint operator +(const fixedpoint& a, const fixedpoint& b);
+  friend fixedpoint operator -(const fixedpoint& a, const fixedpoint& b);
+  friend fixedpoint operator *(const fixedpoint& a, const fixedpoint& b);
+
+};
+
+// Limbs needed to tell apart points size apart, with some to spare
+unsigned fixedpoint_limbs(double size);
+
+struct fixedcomplex {
+  fixedpoint re, im;
+
+  fixedcomplex(double r = 0, double i = 0, unsigned limbs = 2) :
+    re(r, limbs), im(i, limbs)
+  {}
+
+  void set_limbs(unsigned limbs) {
+    re.set_limbs(limbs);
+    im.set_limbs(limbs);
+  }
+
+  std::complex<double> to_complex(void) const { return std::complex<double>(re.to_double(), im.to_double()); }
+};
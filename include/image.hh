@@ -0,0 +1,45 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include "canvas.hh"
+
+// In-memory canvas for rendering without a window
+class Image : public Canvas {
+private:
+  const int32_t _width, _height;
+  std::vector<uint32_t> _pixels;
+
+public:
+  Image(int32_t w, int32_t h);
+
+  void Draw_pixel(int32_t x, int32_t y, int32_t size, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+  void Draw_row(int32_t x, int32_t y, int32_t n, const Colour* colours);
+
+  const int32_t width(void) const { return _width; }
+  const int32_t height(void) const { return _height; }
+
+  // Pixels are stored as ABGR8888, the same as the Vita's texture
+  const uint32_t* pixels(void) const { return _pixels.data(); }
+
+  // Write the image as a binary PPM file, returns false on failure
+  bool Write_PPM(const char* filename) const;
+
+};
@@ -0,0 +1,86 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// Counts of how long something took, in buckets of powers of two microseconds
+// Any thread may add to it at the same time as others
+class Latency_histogram {
+public:
+  static const unsigned num_buckets = 32;	// bucket b holds times from 2^(b-1) up to 2^b - 1 us
+
+private:
+  std::atomic<uint64_t> _buckets[num_buckets];
+  std::atomic<uint64_t> _count, _total, _max;
+
+public:
+  Latency_histogram() {
+    clear();
+  }
+
+  void clear(void) {
+    for (auto& b : _buckets)
+      b = 0;
+    _count = 0;
+    _total = 0;
+    _max = 0;
+  }
+
+  void add(uint64_t us) {
+    unsigned b = 0;
+    while ((b < num_buckets - 1) && (us >> b))
+      b++;
+    _buckets[b].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _total.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = _max.load(std::memory_order_relaxed);
+    while ((us > max) && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed))
+      ;
+  }
+
+  uint64_t count(void) const { return _count; }
+  uint64_t bucket(unsigned b) const { return _buckets[b]; }
+  uint64_t max(void) const { return _max; }
+  uint64_t mean(void) const { return _count ? _total / _count : 0; }
+
+  // Upper bound of the time that a fraction p of the counts were within
+  uint64_t percentile(double p) const {
+    uint64_t target = p * _count, seen = 0;
+    for (unsigned b = 0; b < num_buckets; b++) {
+      seen += _buckets[b];
+      if ((seen > target) || (seen == _count))
+	return std::min<uint64_t>((1ULL << b) - 1, _max);
+    }
+    return _max;
+  }
+
+  // One line of count, mean, median, 99th percentile and maximum in milliseconds
+  std::string summary(const char* name) const {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %llu, mean %.3f ms, median <= %.3f ms, 99%% <= %.3f ms, max %.3f ms\n",
+	     name, (unsigned long long)count(), mean() / 1000.0, percentile(0.5) / 1000.0,
+	     percentile(0.99) / 1000.0, max() / 1000.0);
+    return line;
+  }
+};
@@ -18,62 +18,550 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <complex>
-#include <SDL2/SDL_pixels.h>
-#include <SDL2/SDL_thread.h>
-#include "complexpair.hh"
-#include "display.hh"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "complexpack.hh"
+#include "canvas.hh"
+#include "fixedpoint.hh"
+#include "latency.hh"
+#include "relaxed.hh"
+#include "tilecache.hh"
+#include "trace.hh"
 
 class Mandelbrot {
 private:
-  Display *_display;
-  uint32_t _prec;
-  std::complex<double> _centre[2];
+  Canvas *_canvas;
+  uint32_t _prec, _forced_prec;	// bits of the kernel's arithmetic, or of the reference when perturbing
+  bool _perturbation, _forced_perturbation;
+  fixedcomplex _centre[2];
+  std::complex<double> _centre_d[2];	// _centre rounded to doubles
   double _window_size[2], _pixel_size[2];
   uint32_t _iteration_limit;
-  bool _running, _shutdown, _julia;
-  SDL_Palette *_palette;
+  std::atomic<bool> _running, _shutdown;
+  bool _julia;
 
-  int32_t _next_x, _next_y, _first_pass, _pass, _pass_size;
+  // The window as reset() last handed it to the threads, which read only this so it can be moved while they draw
+  struct Drawing {
+    bool julia = false;
+    fixedcomplex centre, c;	// c is the Julia set's parameter, the Mandelbrot centre
+    std::complex<double> centre_d;
+    double pixel_size = 0;
+    uint32_t prec = 0;
+    bool perturbation = false;
+  } _drawing;
+  std::vector<Colour> _palette;
+  uint32_t _palette_colours;	// entries before the black ones at the end
 
-  SDL_mutex *_coords_mutex;
-  void _get_coords(uint32_t& x, uint32_t& y, uint32_t& size);
+  // Iteration count of every pixel drawn so far, kept from one drawing to the next so that
+  // panning by whole pixels only has to draw the newly exposed strips, and zooming can show
+  // the last drawing's pixels straight away while they are drawn again
+  // |z|^2 of each pixel when it finished is kept alongside, so colouring is a separate pass over both
+  // Threads read pixels other threads are drawing, checking borders and coarse blocks, so every one is Relaxed
+  std::vector<Relaxed<uint32_t>> _iters, _last_iters;
+  std::vector<Relaxed<float>> _norms, _last_norms;
+  static const uint32_t _approximate = 0x80000000;	// flag on a count taken from the nearest pixel of the last drawing
+  static const uint32_t _interior = 0x40000000;		// flag on the count of a pixel that reached the limit, or is
+							// known to be inside the set with a count of _count_mask
+  static const uint32_t _count_mask = 0x3fffffff;
+  static const uint32_t _not_drawn = UINT32_MAX;
+  static const uint32_t _blocked = _not_drawn - 1;	// not drawn, but a coarse block is painting over it
+  bool _iters_valid;		// false once the window has changed other than by panning or zooming
+  bool _limit_changed;		// the iteration limit has changed since the last drawing
+  bool _carrying_on;		// the next reset() carries on with an unchanged window's drawing
+  fixedcomplex _iters_centre;	// window _iters was drawn for
+  double _iters_pixel_size;
+  bool _reusing;			// the current drawing kept pixels from the last one
+  uint32_t _rounds;		// times the tiles are handed out: missing pixels first, then approximate ones
 
-  uint32_t _restart_sem;
+  // Where each pixel that stopped at the iteration limit had got to, so raising the limit carries on from there:
+  // z (or the delta from the reference orbit when perturbing, with the reference index), NaN if it wasn't kept
+  std::vector<double> _resume_re, _resume_im;
+  std::vector<uint32_t> _resume_ref;
+  bool _resuming;		// the current drawing carries on pixels from a lower limit
 
-  SDL_Thread *_threads[4];	// Four threads for the quad-core CPU on the Vita
+  // Keep the orbit of a pixel that reached the iteration limit
+  void _save_orbit(uint32_t x, uint32_t y, double re, double im, uint32_t ref_index);
+
+  // Where to carry on a pixel of the current drawing from, returns false if it starts from the beginning
+  bool _resume_orbit(uint32_t x, uint32_t y, double& re, double& im, uint32_t& ref_index, uint32_t& count) const;
+
+  // Move _iters to the new window and redraw what's kept, or forget them all
+  void _reuse_iters(void);
+
+  // Nearest row or column of the last drawing for each one of the new, or -1 if there isn't one
+  // Only the closest of several taking the same source is marked exact, the others are drawn again first
+  static void _remap(std::vector<int32_t>& src, std::vector<bool>& exact, int32_t n, double scale, double shift);
+
+  // Tiles of earlier drawings, for windows that come back to them
+  Tile_cache _cache;
+  Tile_cache::View _iters_view;	// what _iters was drawn with
+  bool _cache_pending;		// _iters has pixels not yet kept in the cache
+  uint32_t _cached_pixels;	// taken from the cache by the current drawing
+
+  Tile_cache::View _view(void) const;
+
+  // Keep the exact pixels of _iters in the cache
+  void _cache_store(void);
+
+  // Fill in the pixels the new window is missing from the cache, returns how many
+  uint32_t _cache_fetch(void);
+
+  // Make sure no thread is still drawing the last drawing
+  void _quiesce(void);
+
+  // Start again on a drawing that _quiesce() stopped, keeping the pixels it had finished
+  void _carry_on(void);
+
+  // Points are handed out to threads in tiles of up to _tile_size x _tile_size points of a pass
+  static const uint32_t _tile_size = 8;
+
+  struct Pass {
+    uint32_t first_tile;		// index of this pass' first tile
+    uint32_t width, height;		// size of this pass' grid of points
+    uint32_t tiles_down;		// tiles in each column
+  };
+
+  int32_t _first_pass;
+  std::vector<Pass> _passes;	// indexed by pass number, coarsest last
+  uint32_t _num_tiles;
+
+  // Every thread writes _next_tile for each tile it takes, and reads _restart_sem every iteration, so each has
+  // a cache line of its own to keep the threads from invalidating each other's copies of their neighbours
+  static const size_t _cache_line = 64;
+
+  // Next tile to hand out, with the _restart_sem value it belongs to in the top 32 bits
+  char _pad_before_next_tile[_cache_line];
+  std::atomic<uint64_t> _next_tile;
+  char _pad_after_next_tile[_cache_line];
+
+  // Mariani-Silver subdivision, instead of the passes: a rectangle whose border pixels all have the same
+  // iteration count is filled without iterating its inside, any other is split in four by a cross of new points
+  bool _subdivide;
+
+  // Width of the grid of rectangles subdivision starts from
+  static const uint32_t _cell_size = 32;
+
+  // A row or column of pixels
+  struct Segment {
+    uint32_t x, y, dx, dy, length;
+  };
+
+  // Pixels x0 to x1 and y0 to y1, borders included
+  struct Rect {
+    uint32_t x0, y0, x1, y1;
+  };
+
+  // Pixels to iterate, and the rectangles whose borders are complete once they are all done
+  struct Subdivision;
+  struct Job {
+    Subdivision *sub;
+    std::vector<Segment> segments;
+    std::vector<Rect> then;
+    uint32_t next_segment;		// next to hand out, under Subdivision::lock
+    std::atomic<uint32_t> remaining;	// pixels not yet drawn
+  };
+
+  struct Subdivision {
+    uint32_t gen;			// _restart_sem value it belongs to
+    std::mutex lock;
+    std::deque<Job> jobs;		// every job of the drawing, never moved so points can point at theirs
+    std::deque<Job*> queue;		// jobs with segments left to hand out
+    std::atomic<uint32_t> queued;	// segments left in the queue
+    std::atomic<uint32_t> unfinished;	// jobs with pixels not yet drawn
+
+    Subdivision(uint32_t g) : gen(g), queued(0), unfinished(0) {}
+  };
+  std::shared_ptr<Subdivision> _subdivision;	// of the current drawing, when subdividing
+
+  // A thread's current tile, or segment when subdividing
+  struct Tile {
+    uint32_t gen;			// _restart_sem value when it was taken
+    uint32_t pass, round;
+    uint32_t i, i_end;		// current column, in grid points
+    uint32_t j, j_start, j_end, j_step;	// current row, in grid points
+    std::shared_ptr<Subdivision> sub;
+    Job *job;
+    Segment seg;
+    uint32_t k;			// next pixel of seg
+    uint64_t taken;		// Trace::now() when the tile or segment was taken, or UINT64_MAX when not tracing it
+    Tile(uint32_t g, std::shared_ptr<Subdivision> s = nullptr) :
+      gen(g), pass(0), round(0), i(0), i_end(0), j(0), j_start(0), j_end(0), j_step(1),
+      sub(s), job(nullptr), seg{ 0, 0, 0, 0, 0 }, k(0), taken(UINT64_MAX) {}
+  };
+
+  // What a thread has done since it last added it to the totals
+  struct Counters;
+
+  bool _take_tile(Tile& t);
+  bool _take_segment(Tile& t, Counters& counters);
+
+  // Returns false when there are no more points to draw
+  // job is the subdivision job the point belongs to, to hand back to _draw_point
+  bool _get_coords(Tile& t, uint32_t& x, uint32_t& y, uint32_t& size, Job*& job, Counters& counters);
+
+  // A subdivision for a new drawing, starting with a grid of lines _cell_size apart
+  std::shared_ptr<Subdivision> _new_subdivision(uint32_t gen);
+
+  // Queue a job, called with the subdivision's lock held
+  void _push_job(Subdivision& sub, std::vector<Segment>&& segments, std::vector<Rect>&& then);
+
+  // Fill a rectangle with a complete border if it is all one iteration count, otherwise queue the points inside it
+  void _check_rect(Subdivision& sub, const Rect& r, Counters& counters);
+
+  // Called for every pixel of a job once it is in _iters
+  void _job_point_done(Job* job, Counters& counters);
+
+  // Called for the last pixel of a job to be drawn
+  void _finish_job(Job* job, Subdivision& sub, Counters& counters);
+
+  char _pad_before_restart_sem[_cache_line];
+  std::atomic<uint32_t> _restart_sem;
+  char _pad_after_restart_sem[_cache_line];
+
+  // Number of threads still working on the current drawing, and the iterations they have done
+  std::atomic<uint32_t> _active_threads;
+  std::atomic<uint64_t> _iterations, _rebases, _periodic_saved, _rejected, _filled;
+
+  // Threads with nothing to draw sleep on _wake until there's a new drawing, more subdivision work or shutdown,
+  // and wait() sleeps on _idle until the drawing is finished
+  mutable std::mutex _wake_lock;
+  std::condition_variable _wake;
+  mutable std::condition_variable _idle;
+  std::atomic<uint32_t> _sleeping_threads;
+
+  void _wake_threads(void);
+
+  // A thread is shutting down
+  void _thread_stopped(void);
+
+  static const uint32_t _max_passes = 8;	// more than _first_pass, for counting by pass
+
+  struct Counters {
+    uint32_t thread, lanes;	// which thread, and how many points its kernel iterates at once
+    uint64_t iterations, rebases;
+    uint64_t periodic_saved;	// iterations not done on points found to be periodic
+    uint64_t rejected;		// points drawn without iterating, being in the main cardioid or a known bulb
+    uint64_t steps;		// times round the kernel's loop, each iterating every lane whether it has a point or not
+    uint64_t escaped, unresolved, periodic;	// points that escaped, reached the limit, or were found to be periodic
+    uint64_t lock_wait_ns;	// waiting for another thread to let go of the subdivision's lock
+    uint64_t pass_points[_max_passes], pass_iterations[_max_passes];
+
+    Counters(uint32_t t = 0, uint32_t l = 1) :
+      thread(t), lanes(l), iterations(0), rebases(0), periodic_saved(0), rejected(0), steps(0),
+      escaped(0), unresolved(0), periodic(0), lock_wait_ns(0), pass_points{}, pass_iterations{} {}
+
+    // A point of a block of the given size has been drawn after iterating it n more times
+    void point(uint32_t size, uint64_t n) {
+      uint32_t p = 0;
+      while ((1U << p) < size)
+	p++;
+      pass_points[p]++;
+      pass_iterations[p] += n;
+      iterations += n;
+    }
+  };
+
+  // Reference orbit at the centre of the window, for perturbation
+  struct Reference {
+    std::vector<double> re, im;	// Z_n rounded to doubles, ending when it escapes or at the limit
+
+    // Series approximation of the delta after the first skip iterations, for every point of the window:
+    //   d_skip = a u + b u^2 + c u^3, where u = dc / radius
+    uint32_t skip;
+    double radius;		// largest |dc| in the window
+    std::complex<double> a, b, c;
+
+    Reference() : skip(0), radius(1) {}
+  };
+  std::shared_ptr<const Reference> _reference;
+  void _update_reference(void);
+
+  // One thread per CPU by default, or four for the quad-core CPU on the Vita if the number of CPUs isn't known
+  uint32_t _num_threads;
+  bool _affinity;		// pin each thread to a CPU of its own
+  std::vector<std::thread> _threads;
 
   // Allow the thread function to access private data and methods
+  template <typename T, unsigned N>
+  friend int Mandelbrot_simd_thread(Mandelbrot* m);
+  template <unsigned N>
+  friend int Mandelbrot_perturbation_thread(Mandelbrot* m);
   friend int Mandelbrot_sp_thread(void* data);
+  friend int Mandelbrot_ff_thread(void* data);
   friend int Mandelbrot_dp_thread(void* data);
+  friend int Mandelbrot_dd_thread(void* data);
+  friend int Mandelbrot_qd_thread(void* data);
+  friend int Mandelbrot_pt_thread(void* data);
+
+  // When the current drawing was asked for, and the milestones it hasn't reached yet
+  std::chrono::steady_clock::time_point _reset_time;
+  std::atomic<bool> _first_pixel_pending, _finish_pending;
+  std::vector<uint32_t> _pass_points;			// points of each pass of a drawing that keeps none
+  std::vector<std::atomic<uint32_t>> _pass_points_left;	// coarse block points of each pass not yet drawn
+
+  // Microseconds since the current drawing was asked for
+  uint64_t _since_reset(void) const;
+
+  // Threads number themselves as they start
+  std::atomic<uint32_t> _next_thread;
+
+  // Timeline of the threads, drawings and passes, if tracing
+  // Thread n's events go on track n + 1, after the one for whichever thread calls reset()
+  Trace *_trace;
+  static const uint32_t _drawing_track = 1000;	// followed by one for each pass
+  std::vector<std::atomic<uint64_t>> _pass_started;	// Trace::now() when each pass' first tile was taken
+
+  // Record the end of the last tile or segment a thread took
+  void _trace_taken(Tile& t, const char* name, uint32_t thread, const char* arg_name, int64_t arg);
 
+  // Called by a thread that has drawn its share of the current drawing, returns false on shutdown
+  // When subdividing, also returns when more points have been queued
+  bool _wait_for_restart(uint32_t restart_val, Counters& counters);
+
+  void _centre_changed(void);
   void _check_prec(void);
 
+public:
+  // How iteration counts are turned into colours, changing it only takes a recolour() rather than a new drawing
+  struct Colouring {
+    uint32_t offset;		// palette rotation, for cycling the colours
+    bool smooth;		// blend between palette entries by how far past the escape radius points ended up
+    bool interior;		// colour the inside of the set by its final |z| instead of black
+    Colouring() : offset(0), smooth(false), interior(false) {}
+  };
+
+  // How the last drawing's pixels ended up, for choosing the iteration limit
+  struct Escape_stats {
+    uint32_t limit;		// iteration limit they were looked at with
+    uint64_t drawn;		// pixels drawn
+    uint64_t escapes[32];	// pixels that escaped, by the highest bit of their count
+    uint64_t top_octave;	// of those, the ones that took from half the limit up to it
+    uint64_t unresolved;	// pixels that reached the limit without being found inside the set
+    uint64_t inside;		// pixels found inside the set by periodicity or the cardioid and bulb test
+    uint32_t max_escape;	// highest count of a pixel that escaped
+
+    Escape_stats() : limit(0), drawn(0), escapes{}, top_octave(0), unresolved(0), inside(0), max_escape(0) {}
+  };
+
+  // What one thread did for the last drawing
+  struct Thread_stats {
+    uint32_t lanes;		// points iterated at once
+    uint64_t iterations;	// of points, so iterations / (steps * lanes) is how busy the lanes were
+    uint64_t steps;		// times round the loop
+    uint64_t pixels, escaped, unresolved, inside;
+    uint64_t idle_us;		// asleep with nothing to draw while other threads were still drawing
+    uint64_t lock_wait_us;	// waiting for the subdivision's lock
+
+    Thread_stats() : lanes(0), iterations(0), steps(0), pixels(0), escaped(0), unresolved(0), inside(0),
+		     idle_us(0), lock_wait_us(0) {}
+  };
+
+  // Points drawn in each pass of the last drawing, and the iterations they took
+  // Subdivision, and the pixels a pan or zoom draws again, count as pass 0
+  struct Pass_stats {
+    uint64_t pixels, iterations;
+
+    Pass_stats() : pixels(0), iterations(0) {}
+  };
+
+  // How long after reset() was called the drawings reached each milestone
+  struct Latency {
+    Latency_histogram restart;		// every thread had stopped drawing the last one
+    Latency_histogram first_pixel;
+    std::vector<Latency_histogram> passes;	// each coarse pass of a progressive drawing was complete, by pass number
+    Latency_histogram finished;		// every point was drawn
+
+    Latency(size_t num_passes) : passes(num_passes) {}
+  };
+
+  // How a pixel of the cost map was drawn
+  enum class Pixel_source : uint8_t {
+    none,		// not since the map started again, kept from an earlier window or not drawn yet
+    filled,		// by subdivision, without iterating it
+    rejected,		// inside the main cardioid or a known bulb, without iterating it
+    periodic,		// found inside the set by its orbit repeating
+    escaped,
+    unresolved,		// reached the limit
+  };
+
+  // What one pixel cost the drawings of the window, taken from the same counts as thread_stats()
+  struct Pixel_cost {
+    uint32_t iterations;	// added up, so carrying on to a higher limit only adds the new ones
+    uint16_t precision;		// bits of the kernel that last drew it (of the reference when perturbing), 0 if none did
+    bool perturbation;
+    Pixel_source source;	// how it was last drawn
+
+    Pixel_cost() : iterations(0), precision(0), perturbation(false), source(Pixel_source::none) {}
+  };
+
+private:
+  Colouring _colouring;
+
+  // Choosing the iteration limit from the last drawing, with adapt_limit()
+  double _unresolved_threshold;
+  uint32_t _min_limit, _max_limit;
+  uint64_t _escaped_before_raise;	// pixels that had escaped when it last raised the limit, UINT64_MAX if it didn't
+  uint32_t _fruitless_raises;		// raises in a row since the last one that let more pixels escape
+  static const uint32_t _max_fruitless_raises = 3;
+  Escape_stats _escape_stats;
+
+  Latency _latency;
+
+  // Under _wake_lock
+  std::vector<Thread_stats> _thread_stats;
+  std::vector<uint64_t> _asleep_since;	// _since_reset() when each thread went to sleep, if it's asleep for this drawing
+  std::vector<Pass_stats> _pass_stats;
+
+  // Pixel_cost of each pixel, empty unless set_cost_map(true)
+  // How it was drawn is packed as precision << 16 | perturbation << 8 | source
+  std::vector<Relaxed<uint32_t>> _cost_iterations, _cost_how;
+
+  // Colour of a pixel from its count and |z|^2
+  void _colour_index(uint32_t iter, float norm, uint32_t& index, uint32_t& weight) const;
+  Colour _colour(uint32_t iter, float norm) const;
+
   template <typename F>
-  void _draw_point(uint32_t x, uint32_t y, uint32_t size, uint32_t iter, std::complex<F> z);
+  void _draw_point(uint32_t x, uint32_t y, uint32_t size, Job* job, uint32_t iter, uint32_t iterations,
+		   std::complex<F> z, Counters& counters);
+
+  // Paint the block of a coarse point in its colour, without covering pixels finer passes have drawn
+  // covered is true if a coarser block is painting over the point itself
+  static const uint32_t _max_block = 64;	// 1 << _first_pass
+  void _draw_block(uint32_t x, uint32_t y, uint32_t size, bool covered, const Colour& col);
 
 public:
-  Mandelbrot(Display& d);
+  Mandelbrot(Canvas& c);
   ~Mandelbrot();
 
-  int32_t pass(void) const { return _pass; }
+  // The pass currently being handed out
+  int32_t pass(void) const;
+  uint32_t precision(void) const { return _prec; }
+  bool perturbation(void) const { return _perturbation; }
+
+  // Always use the 32, 48 (float-float), 64, 128 (double-double) or 256-bit (quad-double) kernel,
+  // or 0 to choose from the zoom level
+  // With perturbation, prec is the precision of the reference orbit, or 0 to choose from the zoom level
+  void force_precision(uint32_t prec, bool perturbation = false);
+
+  // Draw with Mariani-Silver subdivision instead of progressive passes, takes effect from the next reset()
+  void set_subdivide(bool s) { _subdivide = s; }
+  bool subdivide(void) const { return _subdivide; }
+
+  // Set the number of threads, takes effect from the next start_threads()
+  void set_threads(uint32_t n) { _num_threads = n; }
+  uint32_t threads(void) const { return _num_threads; }
+
+  // Pin thread i to the i-th CPU the process may run on (wrapping around), takes effect from the next start_threads()
+  // Only supported on Linux, elsewhere the threads are left to the scheduler
+  void set_affinity(bool a) { _affinity = a; }
+  bool affinity(void) const { return _affinity; }
+
+  // True once every point of the current drawing has been drawn
+  bool finished(void) const { return !_running && (_active_threads == 0); }
+
+  // Total iterations done by all threads, only up to date once finished
+  uint64_t iterations(void) const { return _iterations; }
+
+  // Times a point was moved back to the start of the reference orbit, when perturbing
+  uint64_t rebases(void) const { return _rebases; }
+
+  // Iterations saved by finding points inside the set from their orbits being periodic
+  uint64_t periodic_saved(void) const { return _periodic_saved; }
+
+  // Points found inside the set from being in the main cardioid or one of the largest bulbs
+  uint64_t rejected(void) const { return _rejected; }
+
+  // Pixels filled in by subdivision without being iterated
+  uint64_t filled(void) const { return _filled; }
+
+  // Iterations every point of the current drawing skipped using the series approximation
+  uint32_t series_skip(void) const;
+
+  // True once the current drawing has drawn any pixel
+  bool pixels_drawn(void) const { return !_first_pixel_pending; }
+
+  // Latencies of the drawings since the last clear_latency()
+  // Pass 0 is when the drawing is finished, so only passes 1 and up are timed
+  const Latency& latency(void) const { return _latency; }
+  void clear_latency(void);
+
+  // What each thread did for the current drawing, and the points of each of its passes, complete once it's finished
+  std::vector<Thread_stats> thread_stats(void) const;
+  std::vector<Pass_stats> pass_stats(void) const;
+
+  // Record the threads, drawings and passes on a timeline, or stop if t is null
+  // Only set it while the threads are stopped
+  void set_trace(Trace* t) { _trace = t; }
+
+  // Keep what each pixel cost, by canvas row, until switched off
+  // It adds up the drawings of one window, carrying on to a higher limit, and starts again when the window moves
+  // Only set it while the threads are stopped
+  void set_cost_map(bool on);
+  std::vector<Pixel_cost> cost_map(void) const;
+
+  // Keep up to bytes of tiles of earlier drawings, to put back into any window that lines up with them
+  // at the same iteration limit and precision, 0 keeps none
+  void set_cache_size(size_t bytes) { _cache.set_max_bytes(bytes); }
+  size_t cache_size(void) const { return _cache.max_bytes(); }
+
+  // Pixels the current drawing took from the cache instead of iterating them
+  uint32_t cached_pixels(void) const { return _cached_pixels; }
+
+  // Wait for the current drawing to finish
+  void wait(void) const;
 
   void switch_type(void);
 
   // Move the window
   void move(double c_re, double c_im, double size);
 
-  // Move the window relative to its size
+  // Move the window to a centre given as decimal strings, for deep zooms
+  void move(const std::string& c_re, const std::string& c_im, double size);
+
+  // Move the window relative to its size, rounded to whole pixels so the next reset() can keep what's still in view
   void move_rel(double r_re, double r_im);
 
-  // Zoom the window relative to its size
+  // Zoom the window relative to its size, the next reset() shows the last drawing stretched to fit before drawing it again
   void zoom_rel(double rel);
 
-  // Reset the drawing of pixels
+  // Reset the drawing of pixels, only drawing the ones not already drawn if the window has just been panned,
+  // and the missing ones before the approximate ones if it has been zoomed
+  // The tile cache keeps the drawing under the window, limit and precision it has now
   void reset(void);
 
-  // Set the iteration limit
+  // Set the iteration limit, the next reset() of an unchanged window only recolours after lowering it,
+  // and only carries on with the points that reached the old limit after raising it
+  // Limits outside min_limit and max_limit are clamped to them
+  static const uint32_t min_limit = 3, max_limit = _count_mask - 1;
   void set_limit(uint32_t limit);
+  uint32_t limit(void) const { return _iteration_limit; }
+
+  // Let adapt_limit() choose the iteration limit between min_limit and max_limit, keeping the pixels on the boundary
+  // that a higher limit would still resolve under threshold (a fraction of those drawn)
+  void set_auto_limit(double threshold, uint32_t min_limit, uint32_t max_limit);
+
+  // Once a drawing has finished, raise the iteration limit if too many pixels may still escape above it, or lower it
+  // if none came near it, returns true if it changed and the window needs a reset()	*** Only in the main thread ***
+  bool adapt_limit(void);
+
+  // What adapt_limit() last based its choice on
+  const Escape_stats& escape_stats(void) const { return _escape_stats; }
+
+  // The threads colour the pixels they draw with it, so this stops them while it changes	*** Only in the main thread ***
+  void set_colouring(const Colouring& c);
+  const Colouring& colouring(void) const { return _colouring; }
+
+  // Colour every drawn pixel again with the current colouring, stopping the threads while it does
+  // *** Only in the main thread ***
+  void recolour(void);
 
   void start_threads(void);
 
@@ -81,4 +569,8 @@ public:
 };
 
 int Mandelbrot_sp_thread(void* data);
+int Mandelbrot_ff_thread(void* data);
 int Mandelbrot_dp_thread(void* data);
+int Mandelbrot_dd_thread(void* data);
+int Mandelbrot_qd_thread(void* data);
+int Mandelbrot_pt_thread(void* data);
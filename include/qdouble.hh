@@ -0,0 +1,165 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cmath>
+#include "doubled.hh"
+
+// Unevaluated sum of four doubles, for about 212 bits of mantissa
+// Addition and multiplication are the "sloppy" versions from Hida, Li and Bailey's QD library
+
+class qdouble {
+private:
+  // a + b + c, with the sum in a and the errors in b and c
+  static void _three_sum(double& a, double& b, double& c) {
+    double t2, t3;
+    double t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = two_sum(t2, t3, c);
+  }
+
+  // The same, with only two terms of the result
+  static void _three_sum2(double& a, double& b, double c) {
+    double t2, t3;
+    double t1 = two_sum(a, b, t2);
+    a = two_sum(c, t1, t3);
+    b = t2 + t3;
+  }
+
+  // Turn five overlapping terms into four non-overlapping ones
+  static qdouble _renorm(double c0, double c1, double c2, double c3, double c4) {
+    if (std::isinf(c0))
+      return qdouble(c0, c1, c2, c3);
+
+    double s0, s1, s2 = 0, s3 = 0;
+    s0 = quick_two_sum(c3, c4, c4);
+    s0 = quick_two_sum(c2, s0, c3);
+    s0 = quick_two_sum(c1, s0, c2);
+    c0 = quick_two_sum(c0, s0, c1);
+
+    s0 = quick_two_sum(c0, c1, s1);
+    if (s1 != 0) {
+      s1 = quick_two_sum(s1, c2, s2);
+      if (s2 != 0) {
+	s2 = quick_two_sum(s2, c3, s3);
+	if (s3 != 0)
+	  s3 += c4;
+	else
+	  s2 += c4;
+      } else {
+	s1 = quick_two_sum(s1, c3, s2);
+	if (s2 != 0)
+	  s2 = quick_two_sum(s2, c4, s3);
+	else
+	  s1 = quick_two_sum(s1, c4, s2);
+      }
+    } else {
+      s0 = quick_two_sum(s0, c2, s1);
+      if (s1 != 0) {
+	s1 = quick_two_sum(s1, c3, s2);
+	if (s2 != 0)
+	  s2 = quick_two_sum(s2, c4, s3);
+	else
+	  s1 = quick_two_sum(s1, c4, s2);
+      } else {
+	s0 = quick_two_sum(s0, c3, s1);
+	if (s1 != 0)
+	  s1 = quick_two_sum(s1, c4, s2);
+	else
+	  s0 = quick_two_sum(s0, c4, s1);
+      }
+    }
+
+    return qdouble(s0, s1, s2, s3);
+  }
+
+public:
+  double c[4];	// most significant first
+
+  qdouble(double d = 0) :
+    c{ d, 0, 0, 0 }
+  {}
+
+  qdouble(double c0, double c1, double c2, double c3) :
+    c{ c0, c1, c2, c3 }
+  {}
+
+  explicit operator double() const { return c[0] + c[1] + c[2] + c[3]; }
+
+  friend qdouble operator -(const qdouble& a) {
+    return qdouble(-a.c[0], -a.c[1], -a.c[2], -a.c[3]);
+  }
+
+  friend qdouble operator +(const qdouble& a, const qdouble& b) {
+    double t0, t1, t2, t3;
+    double s0 = two_sum(a.c[0], b.c[0], t0);
+    double s1 = two_sum(a.c[1], b.c[1], t1);
+    double s2 = two_sum(a.c[2], b.c[2], t2);
+    double s3 = two_sum(a.c[3], b.c[3], t3);
+
+    s1 = two_sum(s1, t0, t0);
+    _three_sum(s2, t0, t1);
+    _three_sum2(s3, t0, t2);
+    t0 = t0 + t1 + t3;
+
+    return _renorm(s0, s1, s2, s3, t0);
+  }
+
+  friend qdouble operator -(const qdouble& a, const qdouble& b) {
+    return a + -b;
+  }
+
+  friend qdouble operator *(const qdouble& a, const qdouble& b) {
+    double q0, q1, q2, q3, q4, q5;
+    double p0 = two_prod(a.c[0], b.c[0], q0);
+    double p1 = two_prod(a.c[0], b.c[1], q1);
+    double p2 = two_prod(a.c[1], b.c[0], q2);
+    double p3 = two_prod(a.c[0], b.c[2], q3);
+    double p4 = two_prod(a.c[1], b.c[1], q4);
+    double p5 = two_prod(a.c[2], b.c[0], q5);
+
+    // Add the terms of each order of magnitude
+    _three_sum(p1, p2, q0);
+    _three_sum(p2, q1, q2);
+    _three_sum(p3, p4, p5);
+
+    double t0, t1;
+    double s0 = two_sum(p2, p3, t0);
+    double s1 = two_sum(q1, p4, t1);
+    double s2 = q2 + p5;
+    s1 = two_sum(s1, t0, t0);
+    s2 += t0 + t1;
+
+    s1 += a.c[0] * b.c[3] + a.c[1] * b.c[2] + a.c[2] * b.c[1] + a.c[3] * b.c[0] + q0 + q3 + q4 + q5;
+
+    return _renorm(p0, p1, s0, s1, s2);
+  }
+
+  friend bool operator >=(const qdouble& a, const qdouble& b) {
+    for (unsigned i = 0; i < 3; i++)
+      if (a.c[i] != b.c[i])
+	return a.c[i] > b.c[i];
+    return a.c[3] >= b.c[3];
+  }
+
+  friend bool operator ==(const qdouble& a, const qdouble& b) {
+    return (a.c[0] == b.c[0]) && (a.c[1] == b.c[1]) && (a.c[2] == b.c[2]) && (a.c[3] == b.c[3]);
+  }
+
+};
@@ -0,0 +1,50 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+
+// A value several threads read and write while a drawing is going on
+// Loads and stores are relaxed, so they are as cheap as plain ones but not data races, and copying
+// one is a load so that it can be kept in a std::vector like a plain value
+// exchange() and compare_exchange() also order what was written before them, for handing pixels over
+template <typename T>
+class Relaxed {
+private:
+  std::atomic<T> _value;
+
+public:
+  Relaxed(T v = T()) : _value(v) {}
+  Relaxed(const Relaxed& other) : _value(other.load()) {}
+
+  Relaxed& operator =(const Relaxed& other) { store(other.load()); return *this; }
+  Relaxed& operator =(T v) { store(v); return *this; }
+  operator T() const { return load(); }
+
+  T load(void) const { return _value.load(std::memory_order_relaxed); }
+  void store(T v) { _value.store(v, std::memory_order_relaxed); }
+  T fetch_add(T v) { return _value.fetch_add(v, std::memory_order_relaxed); }
+
+  T exchange(T v) { return _value.exchange(v, std::memory_order_acq_rel); }
+
+  // Replace expected with v, or set expected to what it holds instead
+  bool compare_exchange(T& expected, T v) {
+    return _value.compare_exchange_strong(expected, v, std::memory_order_acq_rel, std::memory_order_acquire);
+  }
+};
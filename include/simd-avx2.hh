@@ -0,0 +1,91 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// AVX2 backend for simd<T, N>, using FMA when it's available
+
+#include <immintrin.h>
+
+template <>
+struct simd<float, 8> {
+  typedef __m256 vec;
+  typedef __m256 mask;
+
+  static vec set1(float a) { return _mm256_set1_ps(a); }
+
+  static vec add(vec a, vec b) { return _mm256_add_ps(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+  static vec mul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+  static vec div(vec a, vec b) { return _mm256_div_ps(a, b); }
+#ifdef __FMA__
+  static const bool fused = true;
+  static vec madd(vec a, vec b, vec c) { return _mm256_fmadd_ps(a, b, c); }
+  static vec msub(vec a, vec b, vec c) { return _mm256_fnmadd_ps(a, b, c); }
+#else
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+  static vec msub(vec a, vec b, vec c) { return _mm256_sub_ps(c, _mm256_mul_ps(a, b)); }
+#endif
+
+  static mask cmpge(vec a, vec b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+  static mask cmpeq(vec a, vec b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+  static mask mand(mask a, mask b) { return _mm256_and_ps(a, b); }
+  static mask mor(mask a, mask b) { return _mm256_or_ps(a, b); }
+  static mask mnot(mask a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+  static vec select(mask m, vec a, vec b) { return _mm256_blendv_ps(b, a, m); }
+
+  static uint32_t bits(mask m) { return _mm256_movemask_ps(m); }
+
+  static float get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, float a) { v[i] = a; }
+};
+
+template <>
+struct simd<double, 4> {
+  typedef __m256d vec;
+  typedef __m256d mask;
+
+  static vec set1(double a) { return _mm256_set1_pd(a); }
+
+  static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+  static vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+#ifdef __FMA__
+  static const bool fused = true;
+  static vec madd(vec a, vec b, vec c) { return _mm256_fmadd_pd(a, b, c); }
+  static vec msub(vec a, vec b, vec c) { return _mm256_fnmadd_pd(a, b, c); }
+#else
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+  static vec msub(vec a, vec b, vec c) { return _mm256_sub_pd(c, _mm256_mul_pd(a, b)); }
+#endif
+
+  static mask cmpge(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+  static mask cmpeq(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+
+  static mask mand(mask a, mask b) { return _mm256_and_pd(a, b); }
+  static mask mor(mask a, mask b) { return _mm256_or_pd(a, b); }
+  static mask mnot(mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi32(-1))); }
+  static vec select(mask m, vec a, vec b) { return _mm256_blendv_pd(b, a, m); }
+
+  static uint32_t bits(mask m) { return _mm256_movemask_pd(m); }
+
+  static double get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, double a) { v[i] = a; }
+};
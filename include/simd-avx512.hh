@@ -0,0 +1,79 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// AVX-512 backend for simd<T, N>, comparisons give k-register masks
+
+#include <immintrin.h>
+
+template <>
+struct simd<float, 16> {
+  typedef __m512 vec;
+  typedef __mmask16 mask;
+
+  static vec set1(float a) { return _mm512_set1_ps(a); }
+
+  static vec add(vec a, vec b) { return _mm512_add_ps(a, b); }
+  static vec sub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+  static vec mul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+  static vec div(vec a, vec b) { return _mm512_div_ps(a, b); }
+  static const bool fused = true;
+  static vec madd(vec a, vec b, vec c) { return _mm512_fmadd_ps(a, b, c); }
+  static vec msub(vec a, vec b, vec c) { return _mm512_fnmadd_ps(a, b, c); }
+
+  static mask cmpge(vec a, vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+  static mask cmpeq(vec a, vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+
+  static mask mand(mask a, mask b) { return a & b; }
+  static mask mor(mask a, mask b) { return a | b; }
+  static mask mnot(mask a) { return ~a; }
+  static vec select(mask m, vec a, vec b) { return _mm512_mask_blend_ps(m, b, a); }
+
+  static uint32_t bits(mask m) { return m; }
+
+  static float get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, float a) { v[i] = a; }
+};
+
+template <>
+struct simd<double, 8> {
+  typedef __m512d vec;
+  typedef __mmask8 mask;
+
+  static vec set1(double a) { return _mm512_set1_pd(a); }
+
+  static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+  static vec div(vec a, vec b) { return _mm512_div_pd(a, b); }
+  static const bool fused = true;
+  static vec madd(vec a, vec b, vec c) { return _mm512_fmadd_pd(a, b, c); }
+  static vec msub(vec a, vec b, vec c) { return _mm512_fnmadd_pd(a, b, c); }
+
+  static mask cmpge(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+  static mask cmpeq(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+
+  static mask mand(mask a, mask b) { return a & b; }
+  static mask mor(mask a, mask b) { return a | b; }
+  static mask mnot(mask a) { return ~a; }
+  static vec select(mask m, vec a, vec b) { return _mm512_mask_blend_pd(m, b, a); }
+
+  static uint32_t bits(mask m) { return m; }
+
+  static double get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, double a) { v[i] = a; }
+};
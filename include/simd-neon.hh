@@ -0,0 +1,133 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// NEON backend for simd<T, N>
+
+#include <arm_neon.h>
+
+template <>
+struct simd<float, 2> {
+  typedef float32x2_t vec;
+  typedef uint32x2_t mask;
+
+  static vec set1(float a) { return vdup_n_f32(a); }
+
+  static vec add(vec a, vec b) { return vadd_f32(a, b); }
+  static vec sub(vec a, vec b) { return vsub_f32(a, b); }
+  static vec mul(vec a, vec b) { return vmul_f32(a, b); }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return vmla_f32(c, a, b); }
+  static vec msub(vec a, vec b, vec c) { return vmls_f32(c, a, b); }
+
+  static vec div(vec a, vec b) {
+    // No divide instruction, refine the reciprocal estimate instead
+    vec r = vrecpe_f32(b);
+    for (uint8_t i = 0; i < 2; i++)
+      r = vmul_f32(vrecps_f32(b, r), r);
+    return vmul_f32(a, r);
+  }
+
+  static mask cmpge(vec a, vec b) { return vcge_f32(a, b); }
+  static mask cmpeq(vec a, vec b) { return vceq_f32(a, b); }
+
+  static mask mand(mask a, mask b) { return vand_u32(a, b); }
+  static mask mor(mask a, mask b) { return vorr_u32(a, b); }
+  static mask mnot(mask a) { return vmvn_u32(a); }
+  static vec select(mask m, vec a, vec b) { return vbsl_f32(m, a, b); }
+
+  static uint32_t bits(mask m) {
+    return (vget_lane_u32(m, 0) & 1) | (vget_lane_u32(m, 1) & 2);
+  }
+
+  static float get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, float a) { v[i] = a; }
+};
+
+template <>
+struct simd<float, 4> {
+  typedef float32x4_t vec;
+  typedef uint32x4_t mask;
+
+  static vec set1(float a) { return vdupq_n_f32(a); }
+
+  static vec add(vec a, vec b) { return vaddq_f32(a, b); }
+  static vec sub(vec a, vec b) { return vsubq_f32(a, b); }
+  static vec mul(vec a, vec b) { return vmulq_f32(a, b); }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return vmlaq_f32(c, a, b); }
+  static vec msub(vec a, vec b, vec c) { return vmlsq_f32(c, a, b); }
+
+  static vec div(vec a, vec b) {
+    vec r = vrecpeq_f32(b);
+    for (uint8_t i = 0; i < 2; i++)
+      r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+  }
+
+  static mask cmpge(vec a, vec b) { return vcgeq_f32(a, b); }
+  static mask cmpeq(vec a, vec b) { return vceqq_f32(a, b); }
+
+  static mask mand(mask a, mask b) { return vandq_u32(a, b); }
+  static mask mor(mask a, mask b) { return vorrq_u32(a, b); }
+  static mask mnot(mask a) { return vmvnq_u32(a); }
+  static vec select(mask m, vec a, vec b) { return vbslq_f32(m, a, b); }
+
+  static uint32_t bits(mask m) {
+    static const uint32x4_t lane_bits = { 1, 2, 4, 8 };
+    uint32x4_t b = vandq_u32(m, lane_bits);
+    uint32x2_t s = vorr_u32(vget_low_u32(b), vget_high_u32(b));
+    return vget_lane_u32(s, 0) | vget_lane_u32(s, 1);
+  }
+
+  static float get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, float a) { v[i] = a; }
+};
+
+#ifdef __aarch64__
+// ARMv8 has double-precision lanes, and a divide instruction
+template <>
+struct simd<double, 2> {
+  typedef float64x2_t vec;
+  typedef uint64x2_t mask;
+
+  static vec set1(double a) { return vdupq_n_f64(a); }
+
+  static vec add(vec a, vec b) { return vaddq_f64(a, b); }
+  static vec sub(vec a, vec b) { return vsubq_f64(a, b); }
+  static vec mul(vec a, vec b) { return vmulq_f64(a, b); }
+  static vec div(vec a, vec b) { return vdivq_f64(a, b); }
+  static const bool fused = true;
+  static vec madd(vec a, vec b, vec c) { return vfmaq_f64(c, a, b); }
+  static vec msub(vec a, vec b, vec c) { return vfmsq_f64(c, a, b); }
+
+  static mask cmpge(vec a, vec b) { return vcgeq_f64(a, b); }
+  static mask cmpeq(vec a, vec b) { return vceqq_f64(a, b); }
+
+  static mask mand(mask a, mask b) { return vandq_u64(a, b); }
+  static mask mor(mask a, mask b) { return vorrq_u64(a, b); }
+  static mask mnot(mask a) { return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(a))); }
+  static vec select(mask m, vec a, vec b) { return vbslq_f64(m, a, b); }
+
+  static uint32_t bits(mask m) {
+    return (vgetq_lane_u64(m, 0) & 1) | (vgetq_lane_u64(m, 1) & 2);
+  }
+
+  static double get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, double a) { v[i] = a; }
+};
+#endif
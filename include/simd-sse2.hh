@@ -0,0 +1,79 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// SSE2 backend for simd<T, N>
+
+#include <emmintrin.h>
+
+template <>
+struct simd<float, 4> {
+  typedef __m128 vec;
+  typedef __m128 mask;
+
+  static vec set1(float a) { return _mm_set1_ps(a); }
+
+  static vec add(vec a, vec b) { return _mm_add_ps(a, b); }
+  static vec sub(vec a, vec b) { return _mm_sub_ps(a, b); }
+  static vec mul(vec a, vec b) { return _mm_mul_ps(a, b); }
+  static vec div(vec a, vec b) { return _mm_div_ps(a, b); }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static vec msub(vec a, vec b, vec c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+
+  static mask cmpge(vec a, vec b) { return _mm_cmpge_ps(a, b); }
+  static mask cmpeq(vec a, vec b) { return _mm_cmpeq_ps(a, b); }
+
+  static mask mand(mask a, mask b) { return _mm_and_ps(a, b); }
+  static mask mor(mask a, mask b) { return _mm_or_ps(a, b); }
+  static mask mnot(mask a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+  static vec select(mask m, vec a, vec b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+  static uint32_t bits(mask m) { return _mm_movemask_ps(m); }
+
+  static float get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, float a) { v[i] = a; }
+};
+
+template <>
+struct simd<double, 2> {
+  typedef __m128d vec;
+  typedef __m128d mask;
+
+  static vec set1(double a) { return _mm_set1_pd(a); }
+
+  static vec add(vec a, vec b) { return _mm_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm_mul_pd(a, b); }
+  static vec div(vec a, vec b) { return _mm_div_pd(a, b); }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+  static vec msub(vec a, vec b, vec c) { return _mm_sub_pd(c, _mm_mul_pd(a, b)); }
+
+  static mask cmpge(vec a, vec b) { return _mm_cmpge_pd(a, b); }
+  static mask cmpeq(vec a, vec b) { return _mm_cmpeq_pd(a, b); }
+
+  static mask mand(mask a, mask b) { return _mm_and_pd(a, b); }
+  static mask mor(mask a, mask b) { return _mm_or_pd(a, b); }
+  static mask mnot(mask a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+  static vec select(mask m, vec a, vec b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+
+  static uint32_t bits(mask m) { return _mm_movemask_pd(m); }
+
+  static double get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, double a) { v[i] = a; }
+};
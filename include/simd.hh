@@ -0,0 +1,148 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Operations on SIMD vectors of N values of type T
+//
+// Each backend specialises simd<T, N> for the register widths it has, providing:
+//   vec, mask			vector and per-lane mask types
+//   set1(a)			all lanes set to a
+//   add(a, b), sub(a, b), mul(a, b), div(a, b)
+//   madd(a, b, c)			a * b + c
+//   msub(a, b, c)			c - a * b
+//   fused				true when madd and msub only round once
+//   cmpge(a, b), cmpeq(a, b)	per-lane comparisons
+//   mand(a, b), mor(a, b), mnot(a)	mask logic
+//   select(m, a, b)		a in the lanes set in m, b in the others
+//   bits(m)			mask as an integer, lane i in bit i
+//   get(v, i), set(v, i, a)	access to single lanes
+//
+// The primary template uses GCC vector extensions, so any width works on any target
+
+template <typename T> struct simd_int;
+template <> struct simd_int<float> { typedef int32_t type; };
+template <> struct simd_int<double> { typedef int64_t type; };
+
+template <typename T, unsigned N>
+struct simd {
+  typedef T vec __attribute__ ((vector_size (N * sizeof(T))));
+  typedef typename simd_int<T>::type mask __attribute__ ((vector_size (N * sizeof(T))));
+
+  static vec set1(T a) {
+    vec v;
+    for (unsigned i = 0; i < N; i++)
+      v[i] = a;
+    return v;
+  }
+
+  static vec add(vec a, vec b) { return a + b; }
+  static vec sub(vec a, vec b) { return a - b; }
+  static vec mul(vec a, vec b) { return a * b; }
+  static vec div(vec a, vec b) { return a / b; }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return a * b + c; }
+  static vec msub(vec a, vec b, vec c) { return c - a * b; }
+
+  static mask cmpge(vec a, vec b) { return a >= b; }
+  static mask cmpeq(vec a, vec b) { return a == b; }
+
+  static mask mand(mask a, mask b) { return a & b; }
+  static mask mor(mask a, mask b) { return a | b; }
+  static mask mnot(mask a) { return ~a; }
+  static vec select(mask m, vec a, vec b) { return m ? a : b; }
+
+  static uint32_t bits(mask m) {
+    uint32_t b = 0;
+    for (unsigned i = 0; i < N; i++)
+      b |= (m[i] != 0) << i;
+    return b;
+  }
+
+  static T get(const vec& v, unsigned i) { return v[i]; }
+  static void set(vec& v, unsigned i, T a) { v[i] = a; }
+};
+
+// A single lane is plain scalar code, for targets with no vector unit for T
+template <typename T>
+struct simd<T, 1> {
+  typedef T vec;
+  typedef bool mask;
+
+  static vec set1(T a) { return a; }
+
+  static vec add(vec a, vec b) { return a + b; }
+  static vec sub(vec a, vec b) { return a - b; }
+  static vec mul(vec a, vec b) { return a * b; }
+  static vec div(vec a, vec b) { return a / b; }
+  static const bool fused = false;
+  static vec madd(vec a, vec b, vec c) { return a * b + c; }
+  static vec msub(vec a, vec b, vec c) { return c - a * b; }
+
+  static mask cmpge(vec a, vec b) { return a >= b; }
+  static mask cmpeq(vec a, vec b) { return a == b; }
+
+  static mask mand(mask a, mask b) { return a && b; }
+  static mask mor(mask a, mask b) { return a || b; }
+  static mask mnot(mask a) { return !a; }
+  static vec select(mask m, vec a, vec b) { return m ? a : b; }
+
+  static uint32_t bits(mask m) { return m; }
+
+  static T get(const vec& v, unsigned i) { return v; }
+  static void set(vec& v, unsigned i, T a) { v = a; }
+};
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include "simd-neon.hh"
+#endif
+
+#ifdef __SSE2__
+#include "simd-sse2.hh"
+#endif
+
+#ifdef __AVX2__
+#include "simd-avx2.hh"
+#endif
+
+#ifdef __AVX512F__
+#include "simd-avx512.hh"
+#endif
+
+// Widest vector of T that the target has a backend for
+template <typename T> struct simd_native;
+
+#if defined(__AVX512F__)
+template <> struct simd_native<float> { static const unsigned lanes = 16; };
+template <> struct simd_native<double> { static const unsigned lanes = 8; };
+#elif defined(__AVX2__)
+template <> struct simd_native<float> { static const unsigned lanes = 8; };
+template <> struct simd_native<double> { static const unsigned lanes = 4; };
+#elif defined(__SSE2__)
+template <> struct simd_native<float> { static const unsigned lanes = 4; };
+template <> struct simd_native<double> { static const unsigned lanes = 2; };
+#elif defined(__aarch64__)
+template <> struct simd_native<float> { static const unsigned lanes = 4; };
+template <> struct simd_native<double> { static const unsigned lanes = 2; };
+#else
+// The Vita's Cortex-A9 only does two single-precision lanes per cycle anyway, and no double-precision ones
+template <> struct simd_native<float> { static const unsigned lanes = 2; };
+template <> struct simd_native<double> { static const unsigned lanes = 1; };
+#endif
@@ -0,0 +1,92 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+#include "fixedpoint.hh"
+
+// Iteration counts of drawings already done, in square tiles on a grid of pixels of the complex plane, so that going
+// back to a window (or moving to one overlapping it) doesn't have to iterate the pixels again
+// The least recently used tiles are dropped to stay within a size in bytes
+class Tile_cache {
+public:
+  static const int32_t tile_size = 32;
+  static const uint32_t empty = UINT32_MAX;	// count of a pixel the tile doesn't have
+
+  // Everything but the position the counts of a tile depend on
+  struct View {
+    bool julia;
+    fixedcomplex c;		// of a Julia set
+    double pixel_size;
+    uint32_t limit;		// iteration limit
+    uint32_t precision;		// bits of the kernel (or of the reference when perturbing)
+    bool perturbation;
+
+    View() : julia(false), pixel_size(0), limit(0), precision(0), perturbation(false) {}
+  };
+
+  struct Tile {
+    uint32_t iters[tile_size * tile_size];	// by row, empty where not kept
+    float norms[tile_size * tile_size];
+  };
+
+  explicit Tile_cache(size_t max_bytes);
+
+  // Drop tiles until it's within the new size, 0 drops them all and keeps no more
+  void set_max_bytes(size_t max_bytes);
+  size_t max_bytes(void) const { return _max_bytes; }
+  size_t bytes(void) const { return _tiles.size() * sizeof(Tile); }
+
+  void clear(void);
+
+  // Grid of the view that pixels of a window centred on centre line up with, or -1 if none do
+  // Pixel (x, y) of the window is then (x + dx, y + dy) of the grid, and add starts a new grid if there isn't one
+  int32_t grid(const View& view, const fixedcomplex& centre, int64_t& dx, int64_t& dy, bool add);
+
+  // Tile of a grid that covers pixel (tx * tile_size, ty * tile_size) onwards, and mark it most recently used
+  // find returns null if there isn't one, add makes an empty one if there isn't
+  Tile* find(int32_t grid, int64_t tx, int64_t ty);
+  Tile* add(int32_t grid, int64_t tx, int64_t ty);
+
+private:
+  size_t _max_bytes;
+
+  struct Grid {
+    int32_t id;
+    View view;
+    fixedcomplex centre;	// of the window it started with, whose top left pixel is (0, 0)
+    size_t tiles;
+  };
+  std::vector<Grid> _grids;
+  int32_t _next_grid;
+
+  typedef std::tuple<int32_t, int64_t, int64_t> Key;	// grid, tx, ty
+  struct Entry {
+    Key key;
+    Tile tile;
+  };
+  std::list<Entry> _tiles;	// most recently used first
+  std::map<Key, std::list<Entry>::iterator> _index;
+
+  void _drop_last(void);
+};
@@ -0,0 +1,84 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Timed events from any thread, written out as a Chrome trace for chrome://tracing or ui.perfetto.dev
+// Each event goes on a numbered track, which shows as one row of the timeline
+class Trace {
+public:
+  static const uint32_t main_track = 0;	// the thread that made the Trace
+
+  explicit Trace(size_t max_events = 1 << 18);
+
+  // Microseconds since the trace was started, now or at t
+  uint64_t now(void) const;
+  uint64_t at(std::chrono::steady_clock::time_point t) const;
+
+  void name_track(uint32_t track, const std::string& name);
+
+  // Record something that took from start to end on a track, with an optional argument to show with it
+  // name and arg_name must last as long as the trace, usually by being literals
+  void add(uint32_t track, const char* name, uint64_t start, uint64_t end, const char* arg_name = nullptr, int64_t arg = 0);
+
+  // Events not recorded because max_events had been reached
+  uint64_t dropped(void) const;
+
+  // Write the Chrome trace event JSON
+  bool write(const char* filename) const;
+
+  // Times the scope it's declared in, doing nothing if the trace is null
+  class Scope {
+  private:
+    Trace *_trace;
+    uint32_t _track;
+    const char *_name, *_arg_name;
+    int64_t _arg;
+    uint64_t _start;
+
+  public:
+    Scope(Trace* t, uint32_t track, const char* name, const char* arg_name = nullptr, int64_t arg = 0) :
+      _trace(t), _track(track), _name(name), _arg_name(arg_name), _arg(arg), _start(t ? t->now() : 0) {}
+    ~Scope() {
+      if (_trace)
+	_trace->add(_track, _name, _start, _trace->now(), _arg_name, _arg);
+    }
+  };
+
+private:
+  struct Event {
+    const char *name, *arg_name;
+    uint32_t track;
+    uint64_t start, duration;
+    int64_t arg;
+  };
+
+  std::chrono::steady_clock::time_point _start;
+  mutable std::mutex _lock;
+  std::vector<Event> _events;
+  size_t _max_events;
+  uint64_t _dropped;
+  std::map<uint32_t, std::string> _tracks;
+};
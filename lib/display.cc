@@ -17,14 +17,24 @@
 */
 
 #include "display.hh"
+#include <algorithm>
 #include <SDL2/SDL_timer.h>
 
+const int32_t Display::_band_height;
+
 Display::Display() :
   _window(nullptr),
   _renderer(nullptr),
   _texture(nullptr),
+  _pixels(_screen_width * _screen_height, 0xff000000),
+  _upload(_screen_width * _screen_height),
+  _dirty((_screen_height + _band_height - 1) / _band_height),
   _last_redraw(-1)
 {
+  // Upload the whole (black) screen on the first refresh
+  for (auto& d : _dirty)
+    d = true;
+
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     return;
   }
@@ -48,8 +58,6 @@ Display::Display() :
   if (_texture == nullptr) {
     return;
   }
-
-  // TODO: Clear the texture to solid black
 }
 
 Display::~Display() {
@@ -65,26 +73,33 @@ Display::~Display() {
   SDL_Quit();
 }
 
+void Display::_mark_dirty(int32_t y0, int32_t y1) {
+  for (int32_t band = y0 / _band_height; band <= (y1 - 1) / _band_height; band++)
+    if (!_dirty[band].load(std::memory_order_relaxed))
+      _dirty[band].store(true, std::memory_order_release);
+}
+
 void Display::Draw_pixel(int32_t x, int32_t y, int32_t size, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-  SDL_Rect rect = { x, y, size, size };
   uint32_t value = ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
 
-  if (rect.x + rect.w >= _screen_width)
-    rect.w = _screen_width - 1 - rect.x;
-  if (rect.y + rect.h >= _screen_height)
-    rect.h = _screen_height - 1 - rect.y;
+  int32_t w = std::min(size, _screen_width - x);
+  int32_t h = std::min(size, _screen_height - y);
 
-  uint32_t *pixels;
-  int pitch;
+  for (int32_t py = 0; py < h; py++) {
+    Relaxed<uint32_t> *p = _pixels.data() + ((y + py) * _screen_width) + x;
+    for (int32_t px = w; px > 0; px--, p++)
+      p->store(value);
+  }
 
-  SDL_LockTexture(_texture, &rect, (void**)&pixels, &pitch);
+  _mark_dirty(y, y + h);
+}
 
-  for (int32_t py = 0; py < rect.h; py++) {
-    uint32_t *p = pixels + (py * _screen_width);
-    for (int32_t px = rect.w; px; px--, p++)
-      *p = value;
-  }
+void Display::Draw_row(int32_t x, int32_t y, int32_t n, const Colour* colours) {
+  Relaxed<uint32_t> *p = _pixels.data() + (y * _screen_width) + x;
+  for (int32_t i = std::min(n, _screen_width - x); i > 0; i--, p++, colours++)
+    p->store(((uint32_t)colours->a << 24) | ((uint32_t)colours->b << 16) | ((uint32_t)colours->g << 8) | colours->r);
 
+  _mark_dirty(y, y + 1);
 }
 
 int Display::Refresh(void) {
@@ -93,6 +108,27 @@ int Display::Refresh(void) {
     return 0;
 
   if (_texture != nullptr) {
+    // Upload each run of changed bands with one copy, clearing their flags first so
+    // anything drawn while copying is picked up next time
+    int32_t bands = _dirty.size();
+    for (int32_t band = 0; band < bands;) {
+      if (!_dirty[band].exchange(false, std::memory_order_acquire)) {
+	band++;
+	continue;
+      }
+      int32_t first = band++;
+      while ((band < bands) && _dirty[band].exchange(false, std::memory_order_acquire))
+	band++;
+
+      int32_t y0 = first * _band_height, y1 = std::min(band * _band_height, _screen_height);
+      std::copy(_pixels.begin() + (y0 * _screen_width), _pixels.begin() + (y1 * _screen_width), _upload.begin() + (y0 * _screen_width));
+      SDL_Rect rect = { 0, y0, _screen_width, y1 - y0 };
+      int rc = SDL_UpdateTexture(_texture, &rect, _upload.data() + (y0 * _screen_width), _screen_width * sizeof(uint32_t));
+      if (rc < 0) {
+	return rc;
+      }
+    }
+
     int rc = SDL_RenderCopy(_renderer, _texture, nullptr, nullptr);
     if (rc < 0) {
       return rc;
@@ -0,0 +1,245 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fixedpoint.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+
+fixedpoint::fixedpoint(double d, unsigned limbs) :
+  _limbs(std::max(limbs, 2U), 0)
+{
+  bool neg = d < 0;
+  d = std::fabs(d);
+
+  double top = std::floor(d);
+  _limbs.back() = (uint32_t)top;
+  d -= top;
+  for (int i = _limbs.size() - 2; (i >= 0) && (d > 0); i--) {
+    d *= 4294967296.0;
+    double l = std::floor(d);
+    _limbs[i] = (uint32_t)l;
+    d -= l;
+  }
+
+  if (neg)
+    _negate();
+}
+
+// Split a decimal number into its sign, digits and where the point goes among them, false if it isn't one
+static bool parse_decimal(const std::string& s, bool& neg, std::string& digits, long& point) {
+  size_t pos = 0;
+  neg = false;
+  if ((pos < s.size()) && ((s[pos] == '-') || (s[pos] == '+'))) {
+    neg = s[pos] == '-';
+    pos++;
+  }
+
+  digits.clear();
+  point = -1;
+  for (; pos < s.size(); pos++) {
+    char ch = s[pos];
+    if ((ch >= '0') && (ch <= '9'))
+      digits += ch;
+    else if ((ch == '.') && (point < 0))
+      point = digits.size();
+    else
+      break;
+  }
+  if (point < 0)
+    point = digits.size();
+  if (digits.empty())
+    return false;
+
+  // strtol would also skip spaces before the exponent
+  if ((pos < s.size()) && ((s[pos] == 'e') || (s[pos] == 'E'))) {
+    const char *start = s.c_str() + pos + 1, *digit = start + ((*start == '-') || (*start == '+'));
+    if ((*digit < '0') || (*digit > '9'))
+      return false;
+    char *end;
+    long exponent = strtol(start, &end, 10);
+    // Far enough either way to be all zeroes or out of range, without overflowing
+    point += std::min(std::max(exponent, -100000L), 100000L);
+    pos = end - s.c_str();
+  }
+
+  return pos == s.size();
+}
+
+bool fixedpoint::valid(const std::string& s) {
+  bool neg;
+  std::string digits;
+  long point;
+  return parse_decimal(s, neg, digits, point);
+}
+
+fixedpoint::fixedpoint(const std::string& s, unsigned limbs) :
+  _limbs(std::max(limbs, 2U), 0)
+{
+  bool neg;
+  std::string digits;
+  long point;
+  if (!parse_decimal(s, neg, digits, point))
+    return;
+  // Below ten zeroes a limb after the point it rounds to 0, and the integer part only has one limb
+  if (point < -10L * (long)_limbs.size())
+    return;
+  point = std::min(point, 20L);
+
+  // Integer part
+  uint32_t integer = 0;
+  for (int i = 0; i < point; i++)
+    integer = (integer * 10) + (i < (int)digits.size() ? digits[i] - '0' : 0);
+  _limbs.back() = integer;
+
+  // Fraction, dividing in one digit at a time from the least significant
+  for (int i = (int)digits.size() - 1; i >= std::max((int)point, 0); i--) {
+    uint64_t rem = digits[i] - '0';
+    for (int l = _limbs.size() - 2; l >= 0; l--) {
+      uint64_t cur = (rem << 32) | _limbs[l];
+      _limbs[l] = cur / 10;
+      rem = cur % 10;
+    }
+  }
+  // Leading zeroes of a negative exponent
+  for (int i = point; i < 0; i++) {
+    uint64_t rem = 0;
+    for (int l = _limbs.size() - 2; l >= 0; l--) {
+      uint64_t cur = (rem << 32) | _limbs[l];
+      _limbs[l] = cur / 10;
+      rem = cur % 10;
+    }
+  }
+
+  if (neg)
+    _negate();
+}
+
+void fixedpoint::_negate(void) {
+  uint64_t carry = 1;
+  for (auto& l : _limbs) {
+    carry += (uint32_t)~l;
+    l = carry;
+    carry >>= 32;
+  }
+}
+
+void fixedpoint::set_limbs(unsigned limbs) {
+  limbs = std::max(limbs, 2U);
+  if (limbs > _limbs.size())
+    _limbs.insert(_limbs.begin(), limbs - _limbs.size(), 0);
+  else if (limbs < _limbs.size())
+    _limbs.erase(_limbs.begin(), _limbs.begin() + (_limbs.size() - limbs));
+}
+
+double fixedpoint::to_double(void) const {
+  if (negative())
+    return -(-*this).to_double();
+
+  // Only three limbs from the first non-zero one can make it into a double
+  int top = _limbs.size() - 1;
+  double scale = 1;
+  while ((top > 0) && (_limbs[top] == 0)) {
+    top--;
+    scale *= 1.0 / 4294967296.0;
+  }
+
+  double d = 0;
+  for (int i = top; (i >= 0) && (i > top - 3); i--) {
+    d += _limbs[i] * scale;
+    scale *= 1.0 / 4294967296.0;
+  }
+  return d;
+}
+
+fixedpoint& fixedpoint::operator +=(const fixedpoint& other) {
+  if (other._limbs.size() > _limbs.size())
+    set_limbs(other._limbs.size());
+
+  // Line up the integer parts, other may have fewer fraction limbs
+  unsigned offset = _limbs.size() - other._limbs.size();
+  uint64_t carry = 0;
+  for (unsigned i = offset; i < _limbs.size(); i++) {
+    carry += (uint64_t)_limbs[i] + other._limbs[i - offset];
+    _limbs[i] = carry;
+    carry >>= 32;
+  }
+
+  return *this;
+}
+
+fixedpoint& fixedpoint::operator -=(const fixedpoint& other) {
+  return *this += -other;
+}
+
+fixedpoint operator -(const fixedpoint& a) {
+  fixedpoint r(a);
+  r._negate();
+  return r;
+}
+
+fixedpoint operator +(const fixedpoint& a, const fixedpoint& b) {
+  fixedpoint r(a);
+  r += b;
+  return r;
+}
+
+fixedpoint operator -(const fixedpoint& a, const fixedpoint& b) {
+  fixedpoint r(a);
+  r -= b;
+  return r;
+}
+
+fixedpoint operator *(const fixedpoint& a, const fixedpoint& b) {
+  unsigned n = std::max(a.limbs(), b.limbs());
+  fixedpoint ma(a), mb(b);
+  ma.set_limbs(n);
+  mb.set_limbs(n);
+
+  bool neg = ma.negative() != mb.negative();
+  if (ma.negative())
+    ma._negate();
+  if (mb.negative())
+    mb._negate();
+
+  // Schoolbook multiply of the magnitudes, keeping the middle n limbs of the product
+  std::vector<uint32_t> product(n * 2, 0);
+  for (unsigned i = 0; i < n; i++) {
+    uint64_t carry = 0;
+    for (unsigned j = 0; j < n; j++) {
+      carry += (uint64_t)ma._limbs[i] * mb._limbs[j] + product[i + j];
+      product[i + j] = carry;
+      carry >>= 32;
+    }
+    product[i + n] = carry;
+  }
+
+  fixedpoint r(0.0, n);
+  for (unsigned i = 0; i < n; i++)
+    r._limbs[i] = product[i + n - 1];
+  if (neg)
+    r._negate();
+
+  return r;
+}
+
+unsigned fixedpoint_limbs(double size) {
+  // 64 bits below the size and one limb for the integer part
+  int bits = 64 - std::ilogb(size);
+  return 1 + std::max((bits + 31) / 32, 2);
+}
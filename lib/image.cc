@@ -0,0 +1,69 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "image.hh"
+#include <algorithm>
+#include <stdio.h>
+
+Image::Image(int32_t w, int32_t h) :
+  _width(w), _height(h),
+  _pixels(w * h, 0xff000000)
+{}
+
+void Image::Draw_pixel(int32_t x, int32_t y, int32_t size, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  uint32_t value = ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+
+  int32_t w = std::min(size, _width - x);
+  int32_t h = std::min(size, _height - y);
+
+  for (int32_t py = 0; py < h; py++) {
+    uint32_t *p = _pixels.data() + ((y + py) * _width) + x;
+    for (int32_t px = w; px > 0; px--, p++)
+      *p = value;
+  }
+}
+
+void Image::Draw_row(int32_t x, int32_t y, int32_t n, const Colour* colours) {
+  uint32_t *p = _pixels.data() + (y * _width) + x;
+  for (int32_t i = std::min(n, _width - x); i > 0; i--, p++, colours++)
+    *p = ((uint32_t)colours->a << 24) | ((uint32_t)colours->b << 16) | ((uint32_t)colours->g << 8) | colours->r;
+}
+
+bool Image::Write_PPM(const char* filename) const {
+  FILE *fp = fopen(filename, "wb");
+  if (fp == nullptr)
+    return false;
+
+  fprintf(fp, "P6\n%d %d\n255\n", _width, _height);
+
+  std::vector<uint8_t> row(_width * 3);
+  for (int32_t y = 0; y < _height; y++) {
+    const uint32_t *p = _pixels.data() + (y * _width);
+    for (int32_t x = 0; x < _width; x++, p++) {
+      row[x * 3] = *p & 0xff;
+      row[x * 3 + 1] = (*p >> 8) & 0xff;
+      row[x * 3 + 2] = (*p >> 16) & 0xff;
+    }
+    if (fwrite(row.data(), 1, row.size(), fp) != row.size()) {
+      fclose(fp);
+      return false;
+    }
+  }
+
+  return fclose(fp) == 0;
+}
@@ -17,86 +17,756 @@
 */
 
 #include "mandelbrot.hh"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <stdio.h>
-#include "display.hh"
+#include "doubled.hh"
+#include "qdouble.hh"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
-Mandelbrot::Mandelbrot(Display& d) :
-  _display(&d),
-  _prec(32),
+const uint32_t Mandelbrot::_approximate;
+const uint32_t Mandelbrot::_interior;
+const uint32_t Mandelbrot::_count_mask;
+const uint32_t Mandelbrot::_not_drawn;
+const size_t Mandelbrot::_cache_line;
+const uint32_t Mandelbrot::_drawing_track;
+
+// Names of the passes' tracks and events on a trace
+static const char* const pass_names[] = {
+  "pass 0", "pass 1", "pass 2", "pass 3", "pass 4", "pass 5", "pass 6", "pass 7"
+};
+
+// One thread per CPU, or four like the Vita when the number of CPUs isn't known
+static uint32_t default_threads(void) {
+  uint32_t n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 4;
+}
+
+Mandelbrot::Mandelbrot(Canvas& c) :
+  _canvas(&c),
+  _prec(32), _forced_prec(0),
+  _perturbation(false), _forced_perturbation(false),
   _iteration_limit(0),
   _running(false), _shutdown(false), _julia(false),
-  _palette(nullptr),
-  _next_x(0), _next_y(0),
-  _first_pass(6), _pass(_first_pass), _pass_size(1 << _pass),
-  _coords_mutex(SDL_CreateMutex()),
-  _restart_sem(0)
+  _palette_colours(0),
+  _iters(c.width() * c.height(), _not_drawn), _norms(c.width() * c.height(), 0),
+  _iters_valid(false), _limit_changed(false), _carrying_on(false), _iters_pixel_size(1), _reusing(false), _rounds(1),
+  _resume_re(c.width() * c.height(), NAN), _resume_im(c.width() * c.height(), NAN), _resume_ref(c.width() * c.height(), 0),
+  _resuming(false),
+  _cache(16 << 20), _cache_pending(false), _cached_pixels(0),
+  _first_pass(6), _num_tiles(0),
+  _next_tile(UINT32_MAX),	// nothing to draw until the first reset()
+  _subdivide(false),
+  _restart_sem(0),
+  _active_threads(0), _iterations(0), _rebases(0), _periodic_saved(0), _rejected(0), _filled(0),
+  _sleeping_threads(0),
+  _num_threads(default_threads()), _affinity(false),
+  _first_pixel_pending(false), _finish_pending(false), _next_thread(0), _trace(nullptr),
+  _unresolved_threshold(0.01), _min_limit(255), _max_limit(65535), _escaped_before_raise(UINT64_MAX), _fruitless_raises(0),
+  _latency(_first_pass + 1),
+  _pass_stats(_first_pass + 1)
 {
-  _centre[0] = std::complex<double>(-0.5, 0.0);
-  _centre[1] = std::complex<double>(0, 0);
+  _centre[0] = fixedcomplex(-0.5, 0.0);
+  _centre[1] = fixedcomplex(0, 0);
+  _centre_changed();
 
   _window_size[0] = 4;
   _window_size[1] = 4;
 
-  _pixel_size[0] = _window_size[0] / _display->width();
-  _pixel_size[1] = _window_size[1] / _display->width();
+  _pixel_size[0] = _window_size[0] / _canvas->width();
+  _pixel_size[1] = _window_size[1] / _canvas->width();
+
+  // Work out the tiles of every pass, coarsest first
+  _passes.resize(_first_pass + 1);
+  for (int32_t p = _first_pass; p >= 0; p--) {
+    Pass &pass = _passes[p];
+    pass.first_tile = _num_tiles;
+    pass.width = (_canvas->width() + (1 << p) - 1) >> p;
+    pass.height = (_canvas->height() + (1 << p) - 1) >> p;
+    pass.tiles_down = (pass.height + _tile_size - 1) / _tile_size;
+    _num_tiles += pass.tiles_down * ((pass.width + _tile_size - 1) / _tile_size);
+  }
+
+  // Every pass but the first skips the points the one before it drew
+  _pass_points.resize(_first_pass + 1);
+  for (int32_t p = _first_pass; p >= 0; p--) {
+    Pass &pass = _passes[p];
+    _pass_points[p] = pass.width * pass.height;
+    if (p < _first_pass)
+      _pass_points[p] -= ((pass.width + 1) / 2) * ((pass.height + 1) / 2);
+  }
+  _pass_points_left = std::vector<std::atomic<uint32_t>>(_first_pass + 1);
+  _pass_started = std::vector<std::atomic<uint64_t>>(_first_pass + 1);
 }
 
 Mandelbrot::~Mandelbrot() {
-  SDL_DestroyMutex(_coords_mutex);
-
-  if (_palette != nullptr)
-    SDL_FreePalette(_palette);
 }
 
 void Mandelbrot::switch_type(void) {
   _julia ^= true;
+  _iters_valid = false;
 
   if (_julia) {
-    _centre[1] = std::complex<double>(0, 0);
+    _centre[1] = fixedcomplex(0, 0);
+    _centre_changed();
     _window_size[1] = 4;
-    _pixel_size[1] = _window_size[1] / _display->width();
+    _pixel_size[1] = _window_size[1] / _canvas->width();
   }
+
+  _check_prec();
 }
 
 void Mandelbrot::move(double c_re, double c_im, double size) {
-  _centre[_julia] = std::complex<double>(c_re, c_im);
+  _iters_valid = false;
+  _window_size[_julia] = size;
+  _pixel_size[_julia] = size / _canvas->width();
+  _centre[_julia] = fixedcomplex(c_re, c_im, fixedpoint_limbs(_pixel_size[_julia]));
+  _centre_changed();
+
+  _check_prec();
+}
+
+void Mandelbrot::move(const std::string& c_re, const std::string& c_im, double size) {
+  _iters_valid = false;
   _window_size[_julia] = size;
-  _pixel_size[_julia] = size / _display->width();
+  _pixel_size[_julia] = size / _canvas->width();
+  unsigned limbs = fixedpoint_limbs(_pixel_size[_julia]);
+  _centre[_julia].re = fixedpoint(c_re, limbs);
+  _centre[_julia].im = fixedpoint(c_im, limbs);
+  _centre_changed();
 
   _check_prec();
 }
 
 void Mandelbrot::move_rel(double r_re, double r_im) {
-  _centre[_julia] += std::complex<double>(r_re, r_im) * _window_size[_julia];
+  int32_t dx = std::lround(r_re * _canvas->width()), dy = std::lround(r_im * _canvas->width());
+  fixedcomplex &c = _centre[_julia];
+  c.re += fixedpoint(dx * _pixel_size[_julia], c.re.limbs());
+  c.im += fixedpoint(dy * _pixel_size[_julia], c.im.limbs());
+  _centre_changed();
+
+  _check_prec();
 }
 
 void Mandelbrot::zoom_rel(double rel) {
   _window_size[_julia] *= rel;
-  _pixel_size[_julia] = _window_size[_julia] / _display->width();
+  _pixel_size[_julia] = _window_size[_julia] / _canvas->width();
+
+  // Never drop limbs, so zooming back in ends up where it started
+  unsigned limbs = fixedpoint_limbs(_pixel_size[_julia]);
+  if (limbs > _centre[_julia].re.limbs())
+    _centre[_julia].set_limbs(limbs);
 
   _check_prec();
 }
 
+void Mandelbrot::_centre_changed(void) {
+  _centre_d[0] = _centre[0].to_complex();
+  _centre_d[1] = _centre[1].to_complex();
+}
+
+int32_t Mandelbrot::pass(void) const {
+  uint32_t index = _next_tile & 0xffffffff;
+  if (index < _num_tiles * _rounds)
+    index %= _num_tiles;
+  for (int32_t p = 0; p < _first_pass; p++)
+    if (index >= _passes[p].first_tile)
+      return p;
+  return _first_pass;
+}
+
+void Mandelbrot::_quiesce(void) {
+  if (_threads.empty())
+    return;
+
+  // Take away the rest of the last drawing's points, then wait for every thread to notice
+  // It won't reach any more milestones
+  _first_pixel_pending = false;
+  if (_finish_pending.exchange(false) && _trace)
+    _trace->add(_drawing_track, "cancelled", _trace->at(_reset_time), _trace->now(), "limit", _iteration_limit);
+  uint32_t gen = _restart_sem + 1;
+  _next_tile = ((uint64_t)gen << 32) | UINT32_MAX;
+  auto sub = std::atomic_load(&_subdivision);
+  if (sub) {
+    std::lock_guard<std::mutex> guard(sub->lock);
+    sub->queue.clear();
+    sub->queued = 0;
+  }
+  std::atomic_store(&_subdivision, std::shared_ptr<Subdivision>());
+  _restart_sem = gen;
+
+  // Sleeping threads aren't drawing anything, so there's no need to wake them
+  std::unique_lock<std::mutex> lock(_wake_lock);
+  _idle.wait(lock, [this] { return _active_threads == 0; });
+}
+
+void Mandelbrot::_carry_on(void) {
+  _carrying_on = true;
+  reset();
+}
+
+void Mandelbrot::_remap(std::vector<int32_t>& src, std::vector<bool>& exact, int32_t n, double scale, double shift) {
+  src.assign(n, -1);
+  exact.assign(n, false);
+  std::vector<double> best(n, INFINITY);	// distance of the closest new pixel to each source so far
+  std::vector<int32_t> best_i(n, -1);
+  for (int32_t i = 0; i < n; i++) {
+    double pos = (n * 0.5) + ((i - (n * 0.5)) * scale) + shift;
+    int32_t s = std::lround(pos);
+    if ((s < 0) || (s >= n))
+      continue;
+    src[i] = s;
+
+    double dist = std::abs(pos - s);
+    if (dist < best[s]) {
+      if (best_i[s] >= 0)
+	exact[best_i[s]] = false;
+      best[s] = dist;
+      best_i[s] = i;
+      exact[i] = true;
+    }
+  }
+}
+
+void Mandelbrot::_reuse_iters(void) {
+  int32_t width = _canvas->width(), height = _canvas->height();
+  const fixedcomplex &centre = _centre[_julia];
+  double pixel_size = _pixel_size[_julia];
+
+  // Where the new window is in pixels of the last one
+  double scale = pixel_size / _iters_pixel_size;
+  double shift_x = (centre.re - _iters_centre.re).to_double() / _iters_pixel_size;
+  double shift_y = (centre.im - _iters_centre.im).to_double() / _iters_pixel_size;
+  _iters_centre = centre;
+  _iters_pixel_size = pixel_size;
+
+  int32_t dx = std::lround(shift_x), dy = std::lround(shift_y);
+  bool pan = (scale == 1) && (std::abs(shift_x - dx) < 1e-6) && (std::abs(shift_y - dy) < 1e-6);
+
+  // Only a pan, zoom or new iteration limit keeps pixels, resetting an unchanged window draws it all again
+  _reusing = _iters_valid && (!(pan && (dx == 0) && (dy == 0)) || _limit_changed || _carrying_on)
+    && (std::abs(shift_x) < width) && (std::abs(shift_y) < height);
+  _iters_valid = true;
+  _limit_changed = false;
+  _carrying_on = false;
+  bool same_window = _reusing && pan && (dx == 0) && (dy == 0);
+  // The cost map adds up the drawings of one window, and starts again when it moves
+  if (!_cost_iterations.empty() && !same_window) {
+    std::fill(_cost_iterations.begin(), _cost_iterations.end(), 0);
+    std::fill(_cost_how.begin(), _cost_how.end(), 0);
+  }
+  // So does adapt_limit()'s record of what its last raise resolved
+  if (!same_window) {
+    _escaped_before_raise = UINT64_MAX;
+    _fruitless_raises = 0;
+  }
+  _resuming = false;
+  _rounds = 1;
+  if (!_reusing) {
+    std::fill(_iters.begin(), _iters.end(), _not_drawn);
+    return;
+  }
+
+  if (pan) {
+    // Pixel (x, y) is now what was (x + dx, y + dy), go through them in the direction that doesn't overwrite unmoved ones
+    int32_t y0 = dy > 0 ? 0 : height - 1, y_step = dy > 0 ? 1 : -1;
+    int32_t x0 = dx > 0 ? 0 : width - 1, x_step = dx > 0 ? 1 : -1;
+    for (int32_t y = y0; (y >= 0) && (y < height); y += y_step)
+      for (int32_t x = x0; (x >= 0) && (x < width); x += x_step) {
+	int32_t sx = x + dx, sy = y + dy;
+	uint32_t p = y * width + x, sp = sy * width + sx;
+	uint32_t iter = _not_drawn;
+	if ((sx >= 0) && (sx < width) && (sy >= 0) && (sy < height)) {
+	  iter = _iters[sp];
+	  _norms[p] = _norms[sp];
+	  _resume_re[p] = _resume_re[sp];
+	  _resume_im[p] = _resume_im[sp];
+	  _resume_ref[p] = _resume_ref[sp];
+	}
+	_iters[p] = iter;
+	if (iter != _not_drawn) {
+	  Colour col = _colour(iter, _norms[p]);
+	  _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+	}
+      }
+
+    // Pixels that reached a lower limit than this one carry on from where they stopped
+    for (auto& pixel : _iters) {
+      uint32_t iter = pixel;
+      if ((iter != _not_drawn) && (iter & _interior) && ((iter & _count_mask) < _iteration_limit)) {
+	pixel = iter | _approximate;
+	_resuming = true;
+      }
+    }
+    return;
+  }
+
+  // Like XaoS, take each pixel from the nearest of the last drawing and show it straight away
+  // Those that are the only ones to use their source are close enough to be drawn again last,
+  // the rest (new or duplicated rows and columns) are drawn first
+  std::vector<int32_t> src_x, src_y;
+  std::vector<bool> exact_x, exact_y;
+  _remap(src_x, exact_x, width, scale, shift_x);
+  _remap(src_y, exact_y, height, scale, shift_y);
+
+  _last_iters.swap(_iters);
+  _last_norms.swap(_norms);
+  std::fill(_resume_re.begin(), _resume_re.end(), NAN);
+  _iters.resize(width * height);
+  _norms.resize(width * height);
+  for (int32_t y = 0; y < height; y++)
+    for (int32_t x = 0; x < width; x++) {
+      Relaxed<uint32_t> &iter = _iters[y * width + x];
+      iter = _not_drawn;
+      if ((src_x[x] < 0) || (src_y[y] < 0))
+	continue;
+
+      uint32_t last = _last_iters[src_y[y] * width + src_x[x]];
+      float norm = _last_norms[src_y[y] * width + src_x[x]];
+      if (last == _not_drawn)
+	continue;
+      if (exact_x[x] && exact_y[y]) {
+	iter = last | _approximate;
+	_norms[y * width + x] = norm;
+      }
+
+      Colour col = _colour(last, norm);
+      _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+    }
+  _rounds = 2;
+}
+
+Tile_cache::View Mandelbrot::_view(void) const {
+  Tile_cache::View view;
+  view.julia = _julia;
+  if (_julia)
+    view.c = _centre[0];
+  view.pixel_size = _pixel_size[_julia];
+  view.limit = _iteration_limit;
+  view.precision = _prec;
+  view.perturbation = _perturbation;
+  return view;
+}
+
+void Mandelbrot::_cache_store(void) {
+  if (!_cache_pending)
+    return;
+  _cache_pending = false;
+
+  int64_t dx, dy;
+  int32_t grid = _cache.grid(_iters_view, _iters_centre, dx, dy, true);
+  if (grid < 0)
+    return;
+
+  const int32_t ts = Tile_cache::tile_size;
+  int32_t width = _canvas->width(), height = _canvas->height();
+  auto tile_of = [ts](int64_t p) { return p >= 0 ? p / ts : -((ts - 1 - p) / ts); };
+  for (int64_t ty = tile_of(dy); ty <= tile_of(dy + height - 1); ty++)
+    for (int64_t tx = tile_of(dx); tx <= tile_of(dx + width - 1); tx++) {
+      // Only the tile's pixels in the window, and only those drawn exactly
+      int32_t x0 = std::max<int64_t>(tx * ts - dx, 0), x1 = std::min<int64_t>((tx + 1) * ts - dx, width);
+      int32_t y0 = std::max<int64_t>(ty * ts - dy, 0), y1 = std::min<int64_t>((ty + 1) * ts - dy, height);
+      Tile_cache::Tile *tile = _cache.find(grid, tx, ty);
+      for (int32_t y = y0; y < y1; y++)
+	for (int32_t x = x0; x < x1; x++) {
+	  uint32_t p = y * width + x, iter = _iters[p];
+	  if (iter & _approximate)
+	    continue;
+	  if (tile == nullptr)
+	    tile = _cache.add(grid, tx, ty);
+	  uint32_t i = (y + dy - ty * ts) * ts + (x + dx - tx * ts);
+	  tile->iters[i] = iter;
+	  tile->norms[i] = _norms[p];
+	}
+    }
+}
+
+uint32_t Mandelbrot::_cache_fetch(void) {
+  _iters_view = _view();
+  _cache_pending = true;
+
+  int64_t dx, dy;
+  int32_t grid = _cache.grid(_iters_view, _iters_centre, dx, dy, false);
+  if (grid < 0)
+    return 0;
+
+  const int32_t ts = Tile_cache::tile_size;
+  int32_t width = _canvas->width(), height = _canvas->height();
+  auto tile_of = [ts](int64_t p) { return p >= 0 ? p / ts : -((ts - 1 - p) / ts); };
+  uint32_t fetched = 0;
+  for (int64_t ty = tile_of(dy); ty <= tile_of(dy + height - 1); ty++)
+    for (int64_t tx = tile_of(dx); tx <= tile_of(dx + width - 1); tx++) {
+      const Tile_cache::Tile *tile = _cache.find(grid, tx, ty);
+      if (tile == nullptr)
+	continue;
+
+      int32_t x0 = std::max<int64_t>(tx * ts - dx, 0), x1 = std::min<int64_t>((tx + 1) * ts - dx, width);
+      int32_t y0 = std::max<int64_t>(ty * ts - dy, 0), y1 = std::min<int64_t>((ty + 1) * ts - dy, height);
+      for (int32_t y = y0; y < y1; y++)
+	for (int32_t x = x0; x < x1; x++) {
+	  uint32_t p = y * width + x, i = (y + dy - ty * ts) * ts + (x + dx - tx * ts);
+	  if (!(_iters[p] & _approximate) || (tile->iters[i] == Tile_cache::empty))
+	    continue;
+	  // The orbits of cached pixels aren't kept, raising the limit starts them again
+	  _iters[p] = tile->iters[i];
+	  _norms[p] = tile->norms[i];
+	  _resume_re[p] = NAN;
+	  Colour col = _colour(_iters[p], _norms[p]);
+	  _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+	  fetched++;
+	}
+    }
+
+  // Only the pixels still missing are drawn
+  if (fetched > 0)
+    _reusing = true;
+  return fetched;
+}
+
 void Mandelbrot::reset(void) {
-  _next_x = _next_y = 0;
-  _pass = _first_pass;
-  _pass_size = 1 << _pass;
+  auto start = std::chrono::steady_clock::now();
+  _quiesce();
+  if (!_threads.empty())
+    _latency.restart.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  if (_trace)
+    _trace->add(Trace::main_track, "stop last drawing", _trace->at(start), _trace->now());
+  {
+    Trace::Scope scope(_trace, Trace::main_track, "store tiles");
+    _cache_store();
+  }
+  {
+    Trace::Scope scope(_trace, Trace::main_track, "keep pixels");
+    _reuse_iters();
+  }
+  {
+    Trace::Scope scope(_trace, Trace::main_track, "fetch tiles");
+    _cached_pixels = _cache_fetch();
+  }
+
+  uint32_t gen = _restart_sem + 1;
+  _drawing.julia = _julia;
+  _drawing.centre = _centre[_julia];
+  _drawing.c = _centre[0];
+  _drawing.centre_d = _centre_d[_julia];
+  _drawing.pixel_size = _pixel_size[_julia];
+  _drawing.prec = _prec;
+  _drawing.perturbation = _perturbation;
+  _iterations = 0;
+  _rebases = 0;
+  _periodic_saved = 0;
+  _rejected = 0;
+  _filled = 0;
+  _update_reference();
+  _next_tile = (uint64_t)gen << 32;
+  std::atomic_store(&_subdivision, _subdivide ? _new_subdivision(gen) : std::shared_ptr<Subdivision>());
+
+  // Only a drawing that keeps nothing from the last one draws its passes in full
+  _reset_time = start;
+  // Pixels from the cache are on the screen already
+  _first_pixel_pending = _cached_pixels == 0;
+  if (_cached_pixels > 0)
+    _latency.first_pixel.add(_since_reset());
+  _finish_pending = true;
+  for (size_t p = 1; p < _pass_points.size(); p++)
+    _pass_points_left[p] = (_reusing || _subdivide) ? 0 : _pass_points[p];
+  {
+    std::lock_guard<std::mutex> guard(_wake_lock);
+    std::fill(_thread_stats.begin(), _thread_stats.end(), Thread_stats());
+    std::fill(_asleep_since.begin(), _asleep_since.end(), UINT64_MAX);
+    std::fill(_pass_stats.begin(), _pass_stats.end(), Pass_stats());
+  }
+
   _running = true;
-  _restart_sem++;
+  _restart_sem = gen;
+  _wake_threads();
+}
+
+uint64_t Mandelbrot::_since_reset(void) const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _reset_time).count();
+}
+
+void Mandelbrot::clear_latency(void) {
+  _latency.restart.clear();
+  _latency.first_pixel.clear();
+  for (auto& p : _latency.passes)
+    p.clear();
+  _latency.finished.clear();
+}
+
+void Mandelbrot::set_cost_map(bool on) {
+  size_t n = on ? _canvas->width() * _canvas->height() : 0;
+  std::vector<Relaxed<uint32_t>>(n).swap(_cost_iterations);
+  std::vector<Relaxed<uint32_t>>(n).swap(_cost_how);
+}
+
+std::vector<Mandelbrot::Pixel_cost> Mandelbrot::cost_map(void) const {
+  std::vector<Pixel_cost> costs(_cost_iterations.size());
+  for (size_t p = 0; p < costs.size(); p++) {
+    uint32_t how = _cost_how[p];
+    costs[p].iterations = _cost_iterations[p];
+    costs[p].precision = how >> 16;
+    costs[p].perturbation = (how >> 8) & 1;
+    costs[p].source = (Pixel_source)(how & 0xff);
+  }
+  return costs;
+}
+
+void Mandelbrot::force_precision(uint32_t prec, bool perturbation) {
+  _forced_prec = prec;
+  _forced_perturbation = perturbation;
+  _check_prec();
+}
+
+void Mandelbrot::wait(void) const {
+  std::unique_lock<std::mutex> lock(_wake_lock);
+  _idle.wait(lock, [this] { return finished(); });
+}
+
+uint32_t Mandelbrot::series_skip(void) const {
+  auto ref = std::atomic_load(&_reference);
+  return ref ? ref->skip : 0;
+}
+
+bool Mandelbrot::_wait_for_restart(uint32_t restart_val, Counters& counters) {
+  _iterations += counters.iterations;
+  _rebases += counters.rebases;
+  _periodic_saved += counters.periodic_saved;
+  _rejected += counters.rejected;
+
+  // Stopping under the lock means wait() and _quiesce() can't see the drawing finished before it's been timed
+  auto sub = std::atomic_load(&_subdivision);
+  std::unique_lock<std::mutex> lock(_wake_lock);
+  Thread_stats &stats = _thread_stats[counters.thread];
+  stats.lanes = counters.lanes;
+  stats.iterations += counters.iterations;
+  stats.steps += counters.steps;
+  stats.escaped += counters.escaped;
+  stats.unresolved += counters.unresolved;
+  stats.inside += counters.periodic + counters.rejected;
+  stats.lock_wait_us += counters.lock_wait_ns / 1000;
+  for (size_t p = 0; p < _pass_stats.size(); p++) {
+    stats.pixels += counters.pass_points[p];
+    _pass_stats[p].pixels += counters.pass_points[p];
+    _pass_stats[p].iterations += counters.pass_iterations[p];
+  }
+  counters = Counters(counters.thread, counters.lanes);
+
+  uint64_t now = _since_reset();
+  _asleep_since[counters.thread] = now;
+  if (--_active_threads == 0) {
+    if (!_running && _finish_pending.exchange(false)) {
+      _latency.finished.add(now);
+      if (_trace) {
+	uint64_t end = _trace->now();
+	_trace->add(_drawing_track, "drawing", _trace->at(_reset_time), end, "limit", _iteration_limit);
+	if (!_reusing && !_subdivide)
+	  _trace->add(_drawing_track + 1, "pass 0", _pass_started[0], end);
+      }
+
+      // Threads that ran out of points before this one were idle until now
+      for (size_t t = 0; t < _asleep_since.size(); t++)
+	if (_asleep_since[t] != UINT64_MAX) {
+	  _thread_stats[t].idle_us += now - _asleep_since[t];
+	  _asleep_since[t] = UINT64_MAX;
+	}
+    }
+    _idle.notify_all();
+  }
+
+  // _push_job() only wakes us if it sees we're sleeping, so count ourselves before looking at the queue
+  uint64_t slept = _trace ? _trace->now() : 0;
+  _sleeping_threads++;
+  _wake.wait(lock, [&] {
+      return (_restart_sem != restart_val) || _shutdown
+	|| (sub && (sub->gen == restart_val) && (sub->queued > 0));
+    });
+  _sleeping_threads--;
+  if (_trace)
+    _trace->add(counters.thread + 1, "idle", slept, _trace->now());
+  if (_shutdown)
+    return false;
+
+  // Woken for more of the same drawing
+  if (_asleep_since[counters.thread] != UINT64_MAX) {
+    _thread_stats[counters.thread].idle_us += _since_reset() - _asleep_since[counters.thread];
+    _asleep_since[counters.thread] = UINT64_MAX;
+  }
+
+  _active_threads++;
+  return true;
+}
+
+std::vector<Mandelbrot::Thread_stats> Mandelbrot::thread_stats(void) const {
+  std::lock_guard<std::mutex> guard(_wake_lock);
+  return _thread_stats;
+}
+
+std::vector<Mandelbrot::Pass_stats> Mandelbrot::pass_stats(void) const {
+  std::lock_guard<std::mutex> guard(_wake_lock);
+  return _pass_stats;
+}
+
+// Take a lock, adding how long it took to wait_ns if another thread had it
+static void lock_counted(std::unique_lock<std::mutex>& lock, uint64_t& wait_ns) {
+  if (lock.try_lock())
+    return;
+
+  auto start = std::chrono::steady_clock::now();
+  lock.lock();
+  wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Mandelbrot::_wake_threads(void) {
+  // Taking the lock means no thread can be between checking for work and sleeping
+  {
+    std::lock_guard<std::mutex> guard(_wake_lock);
+  }
+  _wake.notify_all();
+}
+
+void Mandelbrot::_thread_stopped(void) {
+  if (--_active_threads == 0) {
+    {
+      std::lock_guard<std::mutex> guard(_wake_lock);
+    }
+    _idle.notify_all();
+  }
+}
+
+static int (*thread_function(uint32_t prec, bool perturbation))(void*) {
+  if (perturbation)
+    return Mandelbrot_pt_thread;
+  if (prec <= 32)
+    return Mandelbrot_sp_thread;
+  if (prec <= 48)
+    return Mandelbrot_ff_thread;
+  if (prec <= 64)
+    return Mandelbrot_dp_thread;
+  if (prec <= 128)
+    return Mandelbrot_dd_thread;
+  return Mandelbrot_qd_thread;
 }
 
 void Mandelbrot::_check_prec(void) {
   uint32_t this_prec = 32;
-  if (_window_size[_julia] < 1e-7 * _display->width())
-    this_prec = 64;
-  if (this_prec != _prec) {
-    stop_threads();
+  bool this_perturbation = false;
+  double resolution = (std::abs(_centre_d[_julia]) + _window_size[_julia]) / _pixel_size[_julia];
+  if (_window_size[_julia] < 1e-7 * _canvas->width()) {
+    // Without double-precision vectors, float-float can beat scalar doubles while its 48 bits are enough,
+    // but only with a fused multiply-add; without one (e.g. the Vita) it is over twice as slow
+    // No target built today has float FMAs without double vectors, so this is never chosen, and the crossover
+    // was measured on a host standing in for one rather than on real hardware: only force_precision(48) gets it
+    if ((simd_native<double>::lanes == 1) && simd<float, simd_native<float>::lanes>::fused
+	&& (resolution <= std::ldexp(1e12, 48 - 53)))
+      this_prec = 48;
+    else
+      this_prec = 64;
+  }
+
+  // Past what doubles can resolve, draw the Mandelbrot set by perturbing around a reference orbit
+  // There is no perturbation for Julia sets, so they move on to the extended precision types instead,
+  // with the same 13 bits of headroom doubles get
+  if (resolution > 1e12) {
+    if (!_julia) {
+      this_prec = 32 * fixedpoint_limbs(_pixel_size[0]);
+      this_perturbation = true;
+    } else if (resolution > std::ldexp(1e12, 53))
+      this_prec = 256;
+    else
+      this_prec = 128;
+  }
+
+  if ((_forced_prec > 0) || _forced_perturbation) {
+    this_prec = _forced_prec;
+    this_perturbation = _forced_perturbation;
+    if (this_perturbation && (this_prec == 0))
+      this_prec = 32 * fixedpoint_limbs(_pixel_size[0]);
+  }
+  // Julia sets fall back to the most precise kernel that can draw them
+  if (_julia && this_perturbation) {
+    this_prec = 256;
+    this_perturbation = false;
+  }
+
+  if ((this_prec != _prec) || (this_perturbation != _perturbation)) {
+    _iters_valid = false;
+    // Threads may not have been started yet
+    bool restart = !_threads.empty()
+      && (thread_function(this_prec, this_perturbation) != thread_function(_prec, _perturbation));
+    Trace::Scope scope(restart ? _trace : nullptr, Trace::main_track, "restart threads", "precision", this_prec);
+    if (restart)
+      stop_threads();
     _prec = this_prec;
-    start_threads();
+    _perturbation = this_perturbation;
+    if (restart)
+      start_threads();
+  }
+}
+
+void Mandelbrot::_update_reference(void) {
+  if (!_perturbation) {
+    std::atomic_store(&_reference, std::shared_ptr<const Reference>());
+    return;
+  }
+
+  Trace::Scope scope(_trace, Trace::main_track, "reference orbit", "limit", _iteration_limit);
+  auto ref = std::make_shared<Reference>();
+  ref->re.reserve(_iteration_limit + 1);
+  ref->im.reserve(_iteration_limit + 1);
+
+  // The series coefficients are scaled by powers of the radius to keep them within range of doubles
+  ref->radius = _pixel_size[0] * 0.5 * std::hypot(_canvas->width(), _canvas->height());
+  // Stop skipping once the first dropped term is no longer lost in the rounding of the linear one,
+  // points near the boundary are sensitive enough that anything more changes the picture
+  const double tolerance = std::numeric_limits<double>::epsilon();
+  std::complex<double> a, b, c, d;	// d is the first dropped term
+  bool series = true;
+
+  fixedcomplex cf = _centre[0];
+  cf.set_limbs(_prec / 32);
+  fixedpoint zr(0.0, _prec / 32), zi(0.0, _prec / 32);
+  std::complex<double> z;
+  ref->re.push_back(0);
+  ref->im.push_back(0);
+  for (uint32_t n = 0; n < _iteration_limit; n++) {
+    if (series) {
+      std::complex<double> z2 = 2.0 * z;
+      std::complex<double> next_a = z2 * a + ref->radius, next_b = z2 * b + a * a;
+      std::complex<double> next_c = z2 * c + 2.0 * a * b, next_d = z2 * d + 2.0 * a * c + b * b;
+      a = next_a;
+      b = next_b;
+      c = next_c;
+      d = next_d;
+      // Written so that an overflow to inf or NaN also stops it
+      series = std::abs(d) <= std::abs(a) * tolerance;
+    }
+
+    fixedpoint rr = zr * zr, ii = zi * zi, ri = zr * zi;
+    zr = rr - ii + cf.re;
+    zi = ri + ri + cf.im;
+
+    z = std::complex<double>(zr.to_double(), zi.to_double());
+    ref->re.push_back(z.real());
+    ref->im.push_back(z.imag());
+    if (std::norm(z) >= 4)
+      break;
+
+    if (series) {
+      ref->skip = n + 1;
+      ref->a = a;
+      ref->b = b;
+      ref->c = c;
+    }
   }
+
+  std::atomic_store(&_reference, std::shared_ptr<const Reference>(ref));
 }
 
-SDL_Color colours1[31] = {
+Colour colours1[31] = {
   {   0,   0,   0, 255 },
   { 120, 119, 238, 255 },
   {  24,   7,  25, 255 },
@@ -131,27 +801,33 @@ SDL_Color colours1[31] = {
 };
 
 void Mandelbrot::set_limit(uint32_t limit) {
+  // Below 3 the last palette segment would be empty, above the maximum the count runs into the flags
+  if (limit < min_limit)
+    limit = min_limit;
+  if (limit > max_limit)
+    limit = max_limit;
+  // The palette is about to change under any thread still drawing
+  _quiesce();
+  _limit_changed |= limit != _iteration_limit;
   _iteration_limit = limit;
+  _update_reference();
 
-  if (_palette != nullptr)
-    delete [] _palette;
-
-  if (_palette != nullptr)
-    SDL_FreePalette(_palette);
-  _palette = SDL_AllocPalette(limit + 1);
+  Trace::Scope scope(_trace, Trace::main_track, "palette", "limit", limit);
+  _palette.resize(limit + 1);
 
   uint32_t n = 0;
 
   uint32_t segmentsize = 8;
   int32_t r_segmentsize = 256 / segmentsize;
-  uint32_t nsegments = 31, setsegments = ((limit + 3) * r_segmentsize) >> 8;
+  // At least one segment, so that the lowest limits still have a colour to escape with
+  uint32_t nsegments = 31, setsegments = std::max(((limit + 3) * r_segmentsize) >> 8, 1U);
   for (uint32_t i = 0; i < setsegments; i++) {
     if (i == (setsegments - 1)) {
       segmentsize = limit - n - 2;
       r_segmentsize = 256 / segmentsize;
     }
 
-    SDL_Color &col1 = colours1[i % nsegments], &col2 = colours1[(i + 1) % setsegments % nsegments];
+    Colour &col1 = colours1[i % nsegments], &col2 = colours1[(i + 1) % setsegments % nsegments];
     int32_t r = col1.r << 8;
     int32_t g = col1.g << 8;
     int32_t b = col1.b << 8;
@@ -160,8 +836,7 @@ void Mandelbrot::set_limit(uint32_t limit) {
     int32_t bs = ((((int32_t)col2.b << 8) - b) * r_segmentsize) >> 8;
 
     for (uint32_t y = 0; y < segmentsize; y++) {
-      SDL_Color col = { (uint8_t)(r >> 8), (uint8_t)(g >> 8), (uint8_t)(b >> 8), 255 };
-      SDL_SetPaletteColors(_palette, &col, n++, 1);
+      _palette[n++] = { (uint8_t)(r >> 8), (uint8_t)(g >> 8), (uint8_t)(b >> 8), 255 };
 
       r += rs;
       g += gs;
@@ -169,197 +844,1066 @@ void Mandelbrot::set_limit(uint32_t limit) {
     }
   }
 
-  while (n < limit + 1) {
-    SDL_Color col = { 0, 0, 0, 255 };
-    SDL_SetPaletteColors(_palette, &col, n++, 1);
+  _palette_colours = n;
+  while (n < limit + 1)
+    _palette[n++] = { 0, 0, 0, 255 };
+}
+
+void Mandelbrot::set_auto_limit(double threshold, uint32_t min_limit, uint32_t max_limit) {
+  _unresolved_threshold = threshold;
+  _min_limit = std::max(min_limit, (uint32_t)Mandelbrot::min_limit);
+  _max_limit = std::min(std::max(max_limit, _min_limit), (uint32_t)Mandelbrot::max_limit);
+}
+
+bool Mandelbrot::adapt_limit(void) {
+  if (!finished())
+    return false;
+
+  Escape_stats stats;
+  uint32_t limit = _iteration_limit;
+  stats.limit = limit;
+  for (uint32_t iter : _iters) {
+    if (iter & _approximate)
+      continue;
+    stats.drawn++;
+    uint32_t count = iter & _count_mask;
+    if (count == _count_mask)
+      stats.inside++;
+    else if (count >= limit)
+      stats.unresolved++;
+    else {
+      uint32_t octave = 0;
+      while ((octave < 31) && (count >> (octave + 1)))
+	octave++;
+      stats.escapes[octave]++;
+      if (count >= limit / 2)
+	stats.top_octave++;
+      stats.max_escape = std::max(stats.max_escape, count);
+    }
+  }
+  _escape_stats = stats;
+
+  // As many pixels as escaped in the last octave below the limit are likely to escape in the octave above it,
+  // if that many are still unresolved, so double the limit while that is too many
+  // With nothing escaping at all, as in deep windows, there's no telling so all the unresolved ones count
+  uint64_t resolvable = stats.max_escape > 0 ? std::min(stats.unresolved, stats.top_octave) : stats.unresolved;
+  // But stop once raising it a few times in a row has let no more pixels escape, as with unresolved points that
+  // are really inside the set, or it would climb all the way to the maximum
+  // Deep windows where nothing has escaped yet get those few doublings to find their first escapes
+  uint64_t escaped = stats.drawn - stats.unresolved - stats.inside;
+  if ((_escaped_before_raise != UINT64_MAX) && (escaped <= _escaped_before_raise + _unresolved_threshold * stats.drawn))
+    _fruitless_raises++;
+  else
+    _fruitless_raises = 0;
+  _escaped_before_raise = UINT64_MAX;
+  uint32_t new_limit = limit;
+  if ((resolvable > _unresolved_threshold * stats.drawn) && (limit < _max_limit)) {
+    if (_fruitless_raises < _max_fruitless_raises) {
+      new_limit = std::min((limit << 1) | 1, _max_limit);
+      _escaped_before_raise = escaped;
+    }
+  } else if (stats.max_escape < limit / 4) {
+    // Nothing came near the limit, so the points inside the set are iterating further than they need to
+    new_limit = _min_limit;
+    while (new_limit < stats.max_escape * 2)
+      new_limit = (new_limit << 1) | 1;
+    new_limit = std::min(new_limit, limit);
   }
+  if (new_limit < _min_limit)
+    new_limit = _min_limit;
+
+  if (new_limit == limit)
+    return false;
+  set_limit(new_limit);
+  return true;
 }
 
-void Mandelbrot::_get_coords(uint32_t& x, uint32_t& y, uint32_t& size) {
-  SDL_LockMutex(_coords_mutex);
+// log2 to within about 0.005, in a form the compiler can vectorise
+static inline float fast_log2(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  float e = (float)((int32_t)(bits >> 23) - 127);
+  bits = (bits & 0x007fffff) | 0x3f800000;
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+  return e + ((-0.34484843f * m + 2.02466578f) * m - 1.67487759f);
+}
 
-  x = _next_x;
-  y = _next_y;
-  size = _pass_size;
+// Palette entry of a pixel and how far (out of 256) towards the next entry it is blended
+inline void Mandelbrot::_colour_index(uint32_t iter, float norm, uint32_t& index, uint32_t& weight) const {
+  uint32_t colours = _palette_colours;
+  // The continuous count is n + 1 - log2(log2 |z|), the fraction runs from 1 to 0 between escape radii of 2 and 4
+  float frac = 1.0f - fast_log2(0.5f * fast_log2(std::max(norm, 4.0f)));
+  frac = _colouring.smooth ? std::min(std::max(frac, 0.0f), 1.0f) : 0.0f;
+  float inside = std::min(norm * 0.25f, 1.0f) * (colours - 1);
 
- increment:
-  _next_y += _pass_size;
-  if (_next_y >= _display->height()) {
-    _next_x += _pass_size;
-    _next_y -= _display->height();
+  bool in = (iter & _count_mask) >= _iteration_limit;
+  index = in ? (_colouring.interior ? (uint32_t)inside : _iteration_limit) : ((iter & _count_mask) + _colouring.offset) % colours;
+  weight = in ? 0 : (uint32_t)(frac * 256.0f);
+}
 
-    if (_next_x >= _display->width()) {
-      if (_pass > 0) {
-	_next_x = _next_y = 0;
-	_pass--;
-	_pass_size = 1 << _pass;
-      } else
-	_running = false;
+Colour Mandelbrot::_colour(uint32_t iter, float norm) const {
+  uint32_t index, weight;
+  _colour_index(iter, norm, index, weight);
+  const Colour &a = _palette[index], &b = _palette[(index + 1) % _palette_colours];
+  if (weight == 0)
+    return a;
+  return { (uint8_t)((a.r * (256 - weight) + b.r * weight) >> 8),
+	   (uint8_t)((a.g * (256 - weight) + b.g * weight) >> 8),
+	   (uint8_t)((a.b * (256 - weight) + b.b * weight) >> 8),
+	   a.a };
+}
+
+void Mandelbrot::set_colouring(const Colouring& c) {
+  bool drawing = !_threads.empty() && _running;
+  _quiesce();
+  _colouring = c;
+  if (drawing)
+    _carry_on();
+}
+
+void Mandelbrot::recolour(void) {
+  if (_palette_colours == 0)
+    return;
+
+  // Otherwise a thread could draw a pixel between this reading its count and painting it
+  bool drawing = !_threads.empty() && _running;
+  _quiesce();
+
+  int32_t width = _canvas->width(), height = _canvas->height();
+  std::vector<uint32_t> index(width), weight(width);
+  std::vector<Colour> row(width);
+  std::vector<uint32_t> iters(width);
+  std::vector<float> norms(width);
+  for (int32_t y = 0; y < height; y++) {
+    std::copy(_iters.begin() + y * width, _iters.begin() + (y + 1) * width, iters.begin());
+    std::copy(_norms.begin() + y * width, _norms.begin() + (y + 1) * width, norms.begin());
+    // Straight-line loop over the row so that it vectorises, lookups and blending follow
+    for (int32_t x = 0; x < width; x++)
+      _colour_index(iters[x], norms[x], index[x], weight[x]);
+    for (int32_t x = 0; x < width; x++) {
+      const Colour &a = _palette[index[x]], &b = _palette[(index[x] + 1) % _palette_colours];
+      uint32_t w = weight[x];
+      row[x] = { (uint8_t)((a.r * (256 - w) + b.r * w) >> 8),
+		 (uint8_t)((a.g * (256 - w) + b.g * w) >> 8),
+		 (uint8_t)((a.b * (256 - w) + b.b * w) >> 8),
+		 a.a };
+    }
+
+    // Pixels not drawn yet keep whatever is on the canvas
+    for (int32_t x = 0; x < width;) {
+      if (iters[x] >= _blocked) {
+	x++;
+	continue;
+      }
+      int32_t start = x;
+      while ((x < width) && (iters[x] < _blocked))
+	x++;
+      _canvas->Draw_row(start, y, x - start, &row[start]);
     }
   }
 
-  if (_running && (_pass < _first_pass)) {
-    for (uint8_t pass = _pass + 1; pass <= _first_pass; pass++) {
-      uint32_t mask = (1 << pass) - 1;
-      if (((_next_x & mask) == 0) && ((_next_y & mask) == 0))
-	goto increment;	// Forgive me.
+  if (drawing)
+    _carry_on();
+}
+
+
+bool Mandelbrot::_take_tile(Tile& t) {
+  uint64_t next = _next_tile;
+  uint32_t index;
+  do {
+    // Is this tile from a newer drawing than the thread is working on?
+    if ((next >> 32) != t.gen)
+      return false;
+
+    index = next & 0xffffffff;
+    if (index >= _num_tiles * _rounds) {
+      _running = false;
+      return false;
     }
+  } while (!_next_tile.compare_exchange_weak(next, next + 1));
+
+  t.round = index / _num_tiles;
+  index %= _num_tiles;
+
+  int32_t p = 0;
+  while (index < _passes[p].first_tile)
+    p++;
+
+  Pass &pass = _passes[p];
+  index -= pass.first_tile;
+  if (_trace && (t.round == 0) && (index == 0))
+    _pass_started[p] = _trace->now();
+  t.pass = p;
+  t.i = (index / pass.tiles_down) * _tile_size;
+  t.i_end = std::min(t.i + _tile_size, pass.width);
+  t.j_start = (index % pass.tiles_down) * _tile_size;
+  t.j_end = std::min(t.j_start + _tile_size, pass.height);
+
+  return true;
+}
+
+bool Mandelbrot::_take_segment(Tile& t, Counters& counters) {
+  Subdivision &sub = *t.sub;
+  if (sub.gen != t.gen)
+    return false;
+
+  std::unique_lock<std::mutex> guard(sub.lock, std::defer_lock);
+  lock_counted(guard, counters.lock_wait_ns);
+  if (sub.queue.empty())
+    return false;
+
+  Job *job = sub.queue.front();
+  t.job = job;
+  t.seg = job->segments[job->next_segment++];
+  t.k = 0;
+  if (job->next_segment == job->segments.size())
+    sub.queue.pop_front();
+  sub.queued--;
+
+  return true;
+}
+
+void Mandelbrot::_trace_taken(Tile& t, const char* name, uint32_t thread, const char* arg_name, int64_t arg) {
+  if (t.taken == UINT64_MAX)
+    return;
+
+  _trace->add(thread + 1, name, t.taken, _trace->now(), arg_name, arg);
+  t.taken = UINT64_MAX;
+}
+
+bool Mandelbrot::_get_coords(Tile& t, uint32_t& x, uint32_t& y, uint32_t& size, Job*& job, Counters& counters) {
+  uint32_t width = _canvas->width();
+  if (t.sub) {
+    do {
+      if (t.k >= t.seg.length) {
+	if (_trace)
+	  _trace_taken(t, "segment", counters.thread, "pixels", t.seg.length);
+	if (!_take_segment(t, counters))
+	  return false;
+	if (_trace)
+	  t.taken = _trace->now();
+      }
+
+      x = t.seg.x + t.k * t.seg.dx;
+      y = t.seg.y + t.k * t.seg.dy;
+      job = t.job;
+      t.k++;
+
+      // Exact pixels kept from the last drawing are done already
+      if (_iters[y * width + x] & _approximate)
+	break;
+      _job_point_done(job, counters);
+    } while (true);
+
+    size = 1;
+    return true;
+  }
+
+  job = nullptr;
+ next:
+  while (t.j >= t.j_end) {
+    // Move on to the next column of the tile, or the next tile
+    t.i++;
+    if (t.i >= t.i_end) {
+      if (_trace)
+	_trace_taken(t, "tile", counters.thread, "pass", t.pass);
+      if (!_take_tile(t))
+	return false;
+      if (_trace)
+	t.taken = _trace->now();
+    }
+
+    // Points with both grid coordinates even were drawn by the previous pass
+    uint32_t skip = (t.pass < (uint32_t)_first_pass) && ((t.i & 1) == 0);
+    t.j = t.j_start + skip;
+    t.j_step = 1 + skip;
   }
 
-  SDL_UnlockMutex(_coords_mutex);
+  x = t.i << t.pass;
+  y = t.j << t.pass;
+  size = 1 << t.pass;
+  t.j += t.j_step;
+
+  // Only draw the pixels a drawing that kept some from the last one is missing, without coarse blocks over the others
+  // When zooming, the missing ones come first and the approximate ones after
+  if (_reusing) {
+    uint32_t iter = _iters[y * width + x];
+    bool draw = iter & _approximate;
+    if (_rounds > 1)
+      draw = (t.round == 0) ? (iter == _not_drawn) : (draw && (iter != _not_drawn));
+    if (!draw)
+      goto next;
+    size = 1;
+  }
+
+  return true;
 }
 
 void Mandelbrot::start_threads(void) {
-  SDL_ThreadFunction fn;
-  if (_prec <= 32)
-    fn = Mandelbrot_sp_thread;
-  else
-    fn = Mandelbrot_dp_thread;
+  int (*fn)(void*) = thread_function(_prec, _perturbation);
+  _next_thread = 0;
+  _thread_stats.assign(_num_threads, Thread_stats());
+  _asleep_since.assign(_num_threads, UINT64_MAX);
 
-  for (uint8_t i = 0; i < 4; i++) {
-    char name[12];
-    snprintf(name, 12, "Mandelbrot%d", i+1);
-    _threads[i] = SDL_CreateThread(fn, name, this);
+  if (_trace) {
+    char name[32];
+    for (uint32_t i = 0; i < _num_threads; i++) {
+      snprintf(name, sizeof(name), "thread %u", i);
+      _trace->name_track(i + 1, name);
+    }
+    _trace->name_track(_drawing_track, "drawings");
+    for (int32_t p = _first_pass; p >= 0; p--)
+      _trace->name_track(_drawing_track + 1 + p, pass_names[p]);
+  }
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  std::vector<int> cpus;
+  if (_affinity && (sched_getaffinity(0, sizeof(allowed), &allowed) == 0))
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      if (CPU_ISSET(cpu, &allowed))
+	cpus.push_back(cpu);
+#endif
+
+  for (uint32_t i = 0; i < _num_threads; i++) {
+    _threads.push_back(std::thread(fn, this));
+#ifdef __linux__
+    if (!cpus.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+      pthread_setaffinity_np(_threads.back().native_handle(), sizeof(set), &set);
+    }
+#endif
   }
 }
 
 template <typename F>
-void Mandelbrot::_draw_point(uint32_t x, uint32_t y, uint32_t size, uint32_t iter, std::complex<F> z) {
-  SDL_Color &col = _palette->colors[iter];
-  _display->Draw_pixel(x, y, size, col.r, col.g, col.b, col.a);
+void Mandelbrot::_draw_point(uint32_t x, uint32_t y, uint32_t size, Job* job, uint32_t iter, uint32_t iterations,
+			     std::complex<F> z, Counters& counters) {
+  uint32_t width = _canvas->width();
+  // Points found inside the set come with the top count, the ones the cardioid and bulb test found without iterating
+  Pixel_source source = iter == _count_mask ? (iterations > 0 ? Pixel_source::periodic : Pixel_source::rejected)
+    : iter < _iteration_limit ? Pixel_source::escaped : Pixel_source::unresolved;
+  counters.point(size, iterations);
+  switch (source) {
+  case Pixel_source::rejected: counters.rejected++; break;
+  case Pixel_source::periodic: counters.periodic++; break;
+  case Pixel_source::escaped: counters.escaped++; break;
+  default: counters.unresolved++; break;
+  }
+  if (!_cost_iterations.empty()) {
+    _cost_iterations[y * width + x].fetch_add(iterations);
+    _cost_how[y * width + x] = (_drawing.prec << 16) | (_drawing.perturbation << 8) | (uint32_t)source;
+  }
+
+  if (iter >= _iteration_limit)
+    iter |= _interior;
+  float norm = (double)z.real() * (double)z.real() + (double)z.imag() * (double)z.imag();
+  _norms[y * width + x] = norm;
+  // A coarse block still painting over this pixel paints it again in its own colour, see _draw_block()
+  bool covered = _iters[y * width + x].exchange(iter) == _blocked;
+
+  if (_first_pixel_pending.load(std::memory_order_relaxed) && _first_pixel_pending.exchange(false))
+    _latency.first_pixel.add(_since_reset());
+
+  Colour col = _colour(iter, norm);
+  if (size > 1)
+    _draw_block(x, y, size, covered, col);
+  else if (!covered)
+    _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+
+  if (job != nullptr)
+    _job_point_done(job, counters);
+
+  // Only the coarse passes of a progressive drawing draw blocks
+  if (size > 1) {
+    uint32_t p = 1;
+    while ((1U << p) < size)
+      p++;
+    if (--_pass_points_left[p] == 0) {
+      _latency.passes[p].add(_since_reset());
+      if (_trace)
+	_trace->add(_drawing_track + 1 + p, pass_names[p], _pass_started[p], _trace->now());
+    }
+  }
+}
+
+void Mandelbrot::_draw_block(uint32_t x, uint32_t y, uint32_t size, bool covered, const Colour& col) {
+  uint32_t width = _canvas->width(), height = _canvas->height();
+  uint32_t x_end = std::min(x + size, width), y_end = std::min(y + size, height);
+
+  // Claim the pixels no pass has drawn yet, so that a point drawn in one from now on leaves it to this block
+  uint64_t claimed[_max_block];		// bit i - x of row j - y
+  bool all = !covered;
+  for (uint32_t j = y; j < y_end; j++) {
+    uint64_t bits = 0;
+    for (uint32_t i = x; i < x_end; i++) {
+      uint32_t iter = _not_drawn;
+      if ((i == x) && (j == y))
+	continue;
+      // Acquiring, so that this paints after any block that had the pixel before
+      if (_iters[j * width + i].compare_exchange(iter, _blocked))
+	bits |= 1ULL << (i - x);
+      else
+	all = false;
+    }
+    claimed[j - y] = bits;
+  }
+
+  if (all)
+    _canvas->Draw_pixel(x, y, size, col.r, col.g, col.b, col.a);
+  else {
+    if (!covered)
+      _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+    for (uint32_t j = y; j < y_end; j++)
+      for (uint32_t i = x; i < x_end; i++)
+	if (claimed[j - y] & (1ULL << (i - x)))
+	  _canvas->Draw_pixel(i, j, 1, col.r, col.g, col.b, col.a);
+  }
+
+  // Hand them back, and paint any that a point was drawn in meanwhile in its colour, since it didn't
+  for (uint32_t j = y; j < y_end; j++)
+    for (uint32_t i = x; i < x_end; i++) {
+      uint32_t iter = _blocked;
+      if ((claimed[j - y] & (1ULL << (i - x))) && !_iters[j * width + i].compare_exchange(iter, _not_drawn)) {
+	Colour drawn = _colour(iter, _norms[j * width + i]);
+	_canvas->Draw_pixel(i, j, 1, drawn.r, drawn.g, drawn.b, drawn.a);
+      }
+    }
+}
+
+void Mandelbrot::_save_orbit(uint32_t x, uint32_t y, double re, double im, uint32_t ref_index) {
+  uint32_t p = y * _canvas->width() + x;
+  _resume_re[p] = re;
+  _resume_im[p] = im;
+  _resume_ref[p] = ref_index;
+}
+
+bool Mandelbrot::_resume_orbit(uint32_t x, uint32_t y, double& re, double& im, uint32_t& ref_index, uint32_t& count) const {
+  if (!_resuming)
+    return false;
+
+  uint32_t p = y * _canvas->width() + x, iter = _iters[p];
+  if (!(iter & _interior) || ((iter & _count_mask) >= _iteration_limit) || std::isnan(_resume_re[p]))
+    return false;
+
+  re = _resume_re[p];
+  im = _resume_im[p];
+  ref_index = _resume_ref[p];
+  count = iter & _count_mask;
+  return true;
+}
+
+void Mandelbrot::_job_point_done(Job* job, Counters& counters) {
+  if (--job->remaining == 0)
+    _finish_job(job, *job->sub, counters);
+}
+
+std::shared_ptr<Mandelbrot::Subdivision> Mandelbrot::_new_subdivision(uint32_t gen) {
+  auto sub = std::make_shared<Subdivision>(gen);
+  uint32_t width = _canvas->width(), height = _canvas->height();
+
+  // Lines every _cell_size pixels, and along the right and bottom edges
+  std::vector<uint32_t> xs, ys;
+  for (uint32_t x = 0; x < width - 1; x += _cell_size)
+    xs.push_back(x);
+  xs.push_back(width - 1);
+  for (uint32_t y = 0; y < height - 1; y += _cell_size)
+    ys.push_back(y);
+  ys.push_back(height - 1);
+
+  std::vector<Segment> segments;
+  std::vector<Rect> then;
+  for (auto y : ys)
+    segments.push_back({ 0, y, 1, 0, width });
+  for (uint32_t b = 0; b + 1 < ys.size(); b++)
+    for (uint32_t a = 0; a < xs.size(); a++) {
+      if (ys[b + 1] - ys[b] > 1)
+	segments.push_back({ xs[a], ys[b] + 1, 0, 1, ys[b + 1] - ys[b] - 1 });
+      if (a + 1 < xs.size())
+	then.push_back({ xs[a], ys[b], xs[a + 1], ys[b + 1] });
+    }
+
+  std::lock_guard<std::mutex> guard(sub->lock);
+  _push_job(*sub, std::move(segments), std::move(then));
+  return sub;
+}
+
+void Mandelbrot::_push_job(Subdivision& sub, std::vector<Segment>&& segments, std::vector<Rect>&& then) {
+  sub.jobs.emplace_back();
+  Job &job = sub.jobs.back();
+  job.sub = &sub;
+  job.segments = std::move(segments);
+  job.then = std::move(then);
+  job.next_segment = 0;
+
+  uint32_t points = 0;
+  for (auto& seg : job.segments)
+    points += seg.length;
+  job.remaining = points;
+
+  sub.unfinished++;
+  sub.queue.push_back(&job);
+  sub.queued += job.segments.size();
+  if (_sleeping_threads > 0)
+    _wake_threads();
+}
+
+void Mandelbrot::_check_rect(Subdivision& sub, const Rect& r, Counters& counters) {
+  if ((r.x1 - r.x0 < 2) || (r.y1 - r.y0 < 2))
+    return;
+
+  uint32_t width = _canvas->width();
+  Relaxed<uint32_t> *iters = _iters.data();
+  // Every pixel inside the set counts the same, whether it reached the limit or was found some other way
+  auto colour_of = [this](uint32_t iter) { return (iter & _count_mask) >= _iteration_limit ? _interior : iter; };
+  uint32_t iter = iters[r.y0 * width + r.x0], key = colour_of(iter);
+  bool same = true;
+  for (uint32_t x = r.x0; same && (x <= r.x1); x++)
+    same = (colour_of(iters[r.y0 * width + x]) == key) && (colour_of(iters[r.y1 * width + x]) == key);
+  for (uint32_t y = r.y0 + 1; same && (y < r.y1); y++)
+    same = (colour_of(iters[y * width + r.x0]) == key) && (colour_of(iters[y * width + r.x1]) == key);
+
+  if (same) {
+    float norm = _norms[r.y0 * width + r.x0];
+    Colour col = _colour(iter, norm);
+    uint32_t filled = 0;
+    for (uint32_t y = r.y0 + 1; y < r.y1; y++)
+      for (uint32_t x = r.x0 + 1; x < r.x1; x++)
+	if (iters[y * width + x] & _approximate) {
+	  // A filled pixel has no orbit of its own to carry on from
+	  iters[y * width + x] = iter;
+	  _norms[y * width + x] = norm;
+	  _resume_re[y * width + x] = NAN;
+	  if (!_cost_how.empty())
+	    _cost_how[y * width + x] = (uint32_t)Pixel_source::filled;
+	  _canvas->Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+	  filled++;
+	}
+    _filled += filled;
+    return;
+  }
+
+  // Nothing to do if everything inside was kept exactly from the last drawing
+  if (_reusing) {
+    bool drawn = true;
+    for (uint32_t y = r.y0 + 1; drawn && (y < r.y1); y++)
+      for (uint32_t x = r.x0 + 1; drawn && (x < r.x1); x++)
+	drawn = !(iters[y * width + x] & _approximate);
+    if (drawn)
+      return;
+  }
+
+  std::vector<Segment> segments;
+  std::vector<Rect> then;
+  if ((r.x1 - r.x0 <= 4) || (r.y1 - r.y0 <= 4)) {
+    // Too small to be worth splitting, iterate everything inside
+    for (uint32_t y = r.y0 + 1; y < r.y1; y++)
+      segments.push_back({ r.x0 + 1, y, 1, 0, r.x1 - r.x0 - 1 });
+  } else {
+    uint32_t xm = (r.x0 + r.x1) / 2, ym = (r.y0 + r.y1) / 2;
+    segments.push_back({ xm, r.y0 + 1, 0, 1, r.y1 - r.y0 - 1 });
+    segments.push_back({ r.x0 + 1, ym, 1, 0, xm - r.x0 - 1 });
+    segments.push_back({ xm + 1, ym, 1, 0, r.x1 - xm - 1 });
+    then = { { r.x0, r.y0, xm, ym }, { xm, r.y0, r.x1, ym }, { r.x0, ym, xm, r.y1 }, { xm, ym, r.x1, r.y1 } };
+  }
+
+  std::unique_lock<std::mutex> guard(sub.lock, std::defer_lock);
+  lock_counted(guard, counters.lock_wait_ns);
+  _push_job(sub, std::move(segments), std::move(then));
+}
+
+void Mandelbrot::_finish_job(Job* job, Subdivision& sub, Counters& counters) {
+  for (auto& r : job->then)
+    _check_rect(sub, r, counters);
+
+  // Rectangles queue their own jobs before this one counts as finished
+  if ((--sub.unfinished == 0) && (sub.gen == _restart_sem))
+    _running = false;
 }
 
 void Mandelbrot::stop_threads(void) {
   _shutdown = true;
-  for (uint8_t i = 0; i < 4; i++) {
-    int status;
-    SDL_WaitThread(_threads[i], &status);
-  }
+  _wake_threads();
+  for (auto& t : _threads)
+    t.join();
+  _threads.clear();
   _shutdown = false;
 }
 
-int Mandelbrot_sp_thread(void* data) {
-  Mandelbrot *m = (Mandelbrot*)data;
+// Rounding the window's coordinates to the arithmetic type of a kernel
+// resumable is whether z survives being kept as a double, for carrying on with it after the limit is raised
+template <typename T>
+struct coords {
+  static const bool resumable = true;
+
+  static T from_fixedpoint(const fixedpoint& f) { return f.to_double(); }
+
+  // A point offset from the centre of the window, the centre also being given as a double
+  static T offset(const T& centre, double centre_d, double offset) { return centre_d + offset; }
+};
 
-  uint32_t x[2], y[2], size[2];
-  complexpair z, c;
-  uint32_t iter[2];
+template <typename T>
+struct coords<doubled<T>> {
+  static const bool resumable = sizeof(doubled<T>) <= sizeof(double);
+
+  static doubled<T> from_fixedpoint(const fixedpoint& f) {
+    T hi = f.to_double();
+    return doubled<T>(hi, (f - fixedpoint(hi, f.limbs())).to_double());
+  }
+
+  static doubled<T> offset(const doubled<T>& centre, double centre_d, double offset) { return centre + offset; }
+};
+
+template <>
+struct coords<qdouble> {
+  static const bool resumable = false;
+
+  static qdouble from_fixedpoint(const fixedpoint& f) {
+    qdouble q;
+    fixedpoint rest = f;
+    for (unsigned i = 0; i < 4; i++) {
+      q.c[i] = rest.to_double();
+      rest -= fixedpoint(q.c[i], f.limbs());
+    }
+    return q;
+  }
+
+  static qdouble offset(const qdouble& centre, double centre_d, double offset) { return centre + offset; }
+};
+
+// Circles inside the largest bulbs after the main cardioid and period-2 bulb, found by tracing each bulb's boundary
+// Only the upper half is listed, as the set is symmetric about the real axis
+static const struct {
+  double re, im, r;
+} interior_bulbs[] = {
+  { -0.124860, 0.743975, 0.0940 },	// period 3
+  { -1.309011, 0.0,      0.0587 },	// period 4, on the period-2 bulb
+  {  0.281076, 0.531064, 0.0437 },	// period 4
+  { -0.504543, 0.562970, 0.0385 },	// period 5
+  { -1.138202, 0.239536, 0.0263 },	// period 6, on the period-2 bulb
+  {  0.379317, 0.335933, 0.0234 },	// period 5
+};
+
+// Mask of the lanes of c inside the box around the cardioid and bulbs, to cheaply pass over most points outside the set
+template <typename ops>
+typename ops::mask near_interior(const typename ops::vec& re, const typename ops::vec& im) {
+  return ops::mand(ops::mand(ops::cmpge(re, ops::set1(-1.37)), ops::cmpge(ops::set1(0.41), re)),
+		   ops::mand(ops::cmpge(im, ops::set1(-0.84)), ops::cmpge(ops::set1(0.84), im)));
+}
+
+// Mask of the lanes of c that are known to be inside the Mandelbrot set without iterating them
+template <typename ops>
+typename ops::mask known_interior(const typename ops::vec& re, const typename ops::vec& im) {
+  typedef typename ops::vec vec;
+  typedef typename ops::mask mask;
+
+  // Main cardioid: q(q + x - 1/4) <= y^2 / 4, where q = (x - 1/4)^2 + y^2
+  vec im2 = ops::mul(im, im);
+  vec xq = ops::sub(re, ops::set1(0.25));
+  vec q = ops::madd(xq, xq, im2);
+  mask inside = ops::cmpge(ops::mul(im2, ops::set1(0.25)), ops::mul(q, ops::add(q, xq)));
+
+  // Period-2 bulb: a circle of radius 1/4 around -1
+  vec x2 = ops::add(re, ops::set1(1));
+  inside = ops::mor(inside, ops::cmpge(ops::set1(0.0625), ops::madd(x2, x2, im2)));
+
+  for (auto& b : interior_bulbs) {
+    vec dr = ops::sub(re, ops::set1(b.re));
+    vec dr2 = ops::mul(dr, dr), r2 = ops::set1(b.r * b.r);
+    vec di = ops::sub(im, ops::set1(b.im));
+    inside = ops::mor(inside, ops::cmpge(r2, ops::madd(di, di, dr2)));
+    if (b.im != 0) {
+      di = ops::add(im, ops::set1(b.im));
+      inside = ops::mor(inside, ops::cmpge(r2, ops::madd(di, di, dr2)));
+    }
+  }
+
+  return inside;
+}
+
+// Iterate N points at a time, refilling each lane as its point finishes
+// Points inside the set are caught early with Brent's method: each orbit is compared against the z it
+// had at the last power of two iterations, and is periodic if it comes back to it
+// To keep the cost down, orbits are only compared and saved every check_every iterations, for all lanes at once
+template <typename T, unsigned N>
+int Mandelbrot_simd_thread(Mandelbrot* m) {
+  typedef complexpack<T, N> pack;
+  typedef typename pack::ops ops;
+  typedef typename pack::vec vec;
+
+  uint32_t x[N], y[N], size[N];
+  Mandelbrot::Job *job[N];
+  pack z, c;
+  pack saved;			// z to compare against for periodicity
+  vec age, save_age;		// checks since each lane was refilled, and when to next save its z
+  uint64_t n = 0, start[N];	// iterations done by the thread, and when each lane was refilled
+  uint32_t from[N];		// iterations each lane's point had done in earlier drawings
+  uint64_t next_limit;		// when the oldest lane will hit the iteration limit
+  uint32_t active;		// bit mask of lanes with a point
   uint32_t restart_val;
+  Mandelbrot::Tile tile(0);
+  Mandelbrot::Counters counters(m->_next_thread++, N);
+  uint64_t counted_n = 0;	// n when the steps were last counted
+  T centre_re, centre_im, julia_re, julia_im;	// in the kernel's precision
+  vec epsilon;			// squared distance within which an orbit has come back
+
+  // Periodicity checking only pays for itself near the set, so stop while points keep escaping
+  uint32_t escapes_in_a_row = 0;
+  const uint64_t check_every = 8;
+  const vec one = ops::set1(1);
+
+  const vec four = ops::set1(4);
+
+  auto reset_values = [m, &tile, &x, &y, &size, &job, &z, &c, &saved, &age, &save_age, &n, &start, &from, &active, &counters,
+		       &centre_re, &centre_im, &julia_re, &julia_im](unsigned i) {
+    start[i] = n;
+    from[i] = 0;
+    ops::set(age, i, 0);
+    ops::set(save_age, i, 1);
+    if (!m->_get_coords(tile, x[i], y[i], size[i], job[i], counters)) {
+      // Nothing left to draw, keep this lane iterating on zero
+      active &= ~(1U << i);
+      z.set(i);
+      c.set(i);
+      saved.set(i);
+      return;
+    }
+    active |= 1U << i;
 
-  auto reset_values = [m, &x, &y, &size, &z, &c, &iter](uint8_t i) {
-    m->_get_coords(x[i], y[i], size[i]);
-    std::complex<float> point(x[i] - (m->_display->width() * 0.5),
-			      (m->_display->height() / m->_display->height()) * (y[i] - (m->_display->height() * 0.5)));
-    point *= m->_pixel_size[m->_julia];
-    point += m->_centre[m->_julia];
-    if (m->_julia) {
+    std::complex<double> offset(x[i] - (m->_canvas->width() * 0.5),
+				(m->_canvas->height() / m->_canvas->height()) * (y[i] - (m->_canvas->height() * 0.5)));
+    offset *= m->_drawing.pixel_size;
+    const std::complex<double> &centre_d = m->_drawing.centre_d;
+    T re = coords<T>::offset(centre_re, centre_d.real(), offset.real());
+    T im = coords<T>::offset(centre_im, centre_d.imag(), offset.imag());
+    if (m->_drawing.julia) {
       // Julia set
-      z.set(i, point);
-      c.set(i, m->_centre[0]);
+      z.set(i, re, im);
+      c.set(i, julia_re, julia_im);
+      saved.set(i, re, im);
     } else {
       // Mandelbrot set
-      z.set(i, 0);
-      c.set(i, point);
+      z.set(i);
+      c.set(i, re, im);
+      saved.set(i);
+    }
+
+    // Carry on from where the point stopped at a lower limit
+    double z_re, z_im;
+    uint32_t ref_index;
+    if (coords<T>::resumable && m->_resume_orbit(x[i], y[i], z_re, z_im, ref_index, from[i])) {
+      z.set(i, T(z_re), T(z_im));
+      saved.set(i, T(z_re), T(z_im));
     }
-    iter[i] = 0;
   };
 
+  // Draw the newly filled lanes that are known to be inside the set straight away, refilling them until none are
+  auto reject_interior = [m, &x, &y, &size, &job, &z, &c, &active, &counters, &escapes_in_a_row, &reset_values](uint32_t lanes) {
+    if (m->_drawing.julia)
+      return;
+    while ((lanes &= active)) {
+      if (!(ops::bits(near_interior<ops>(c.reals(), c.imags())) & lanes))
+	return;
+
+      uint32_t inside = ops::bits(known_interior<ops>(c.reals(), c.imags())) & lanes;
+      lanes = 0;
+      for (unsigned i = 0; i < N; i++)
+	if (inside & (1U << i)) {
+	  m->_draw_point(x[i], y[i], size[i], job[i], Mandelbrot::_count_mask, 0, z.get(i), counters);
+	  escapes_in_a_row = 0;
+
+	  reset_values(i);
+	  lanes |= 1U << i;
+	}
+    }
+  };
+
+  auto find_next_limit = [m, &start, &from, &active, &next_limit](void) {
+    next_limit = UINT64_MAX;
+    for (unsigned i = 0; i < N; i++)
+      if ((active & (1U << i)) && (start[i] + (m->_iteration_limit - from[i]) < next_limit))
+	next_limit = start[i] + (m->_iteration_limit - from[i]);
+  };
+
+  // Counted as working on a drawing from here until it's sleeping in _wait_for_restart() or shut down
+  m->_active_threads++;
+
  restart:
   restart_val = m->_restart_sem;
-  reset_values(0);
-  reset_values(1);
+  tile = Mandelbrot::Tile(restart_val, std::atomic_load(&m->_subdivision));
+  centre_re = coords<T>::from_fixedpoint(m->_drawing.centre.re);
+  centre_im = coords<T>::from_fixedpoint(m->_drawing.centre.im);
+  julia_re = coords<T>::from_fixedpoint(m->_drawing.c.re);
+  julia_im = coords<T>::from_fixedpoint(m->_drawing.c.im);
+  epsilon = ops::set1(sqr(m->_drawing.pixel_size / 1024));
+  active = 0;
+  for (unsigned i = 0; i < N; i++)
+    reset_values(i);
+  reject_interior(active);
+  find_next_limit();
 
-  while (!m->_shutdown) {
-    while (!m->_running && !m->_shutdown)
-      SDL_Delay(1);
-    if (m->_shutdown)
-      return 0;
+  // Checked every iteration, so only needs to be seen eventually; the restart reads them again in order
+  while (!m->_shutdown.load(std::memory_order_relaxed)) {
+    if (active == 0) {
+      // Finished our share of this drawing, wait for the next one
+      counters.steps += n - counted_n;
+      counted_n = n;
+      if (!m->_wait_for_restart(restart_val, counters))
+	return 0;
+      goto restart;
+    }
 
-    if (m->_restart_sem != restart_val)
+    if (m->_restart_sem.load(std::memory_order_relaxed) != restart_val)
       goto restart;
 
-    z = sqr(z) + c;
-    iter[0]++;
-    iter[1]++;
+    // Check |z| before squaring it, so the squares can be shared with the next iteration
+    vec re2 = ops::mul(z.reals(), z.reals());
+    vec im2 = ops::mul(z.imags(), z.imags());
+    uint32_t escaped = ops::bits(ops::cmpge(ops::add(re2, im2), four)) & active;
 
-    bool done[2] = { false, false };
-    for (uint8_t i = 0; i < 2; i++) {
-      if ((iter[i] >= m->_iteration_limit)
-	  || (z.real(i) < -2) || (z.real(i) > 2)
-	  || (z.imag(i) < -2) || (z.imag(i) > 2)) {
-	m->_draw_point(x[i], y[i], size[i], iter[i], z.get(i));
+    uint32_t periodic = 0;
+    if (((n & (check_every - 1)) == 0) && (escapes_in_a_row < 2 * N)) {
+      vec dr = ops::sub(z.reals(), saved.reals()), di = ops::sub(z.imags(), saved.imags());
+      periodic = ops::bits(ops::cmpge(epsilon, ops::madd(di, di, ops::mul(dr, dr)))) & active;
 
-	reset_values(i);
-	done[i] = true;
-      }
+      // Save z in the lanes that have reached their next power of two, and double the distance to the one after
+      age = ops::add(age, one);
+      typename ops::mask save = ops::cmpge(age, save_age);
+      saved = pack(ops::select(save, z.reals(), saved.reals()), ops::select(save, z.imags(), saved.imags()));
+      save_age = ops::select(save, ops::add(age, age), save_age);
     }
 
-    if (!done[0] && !done[1]) {
-      float32x2_t n = norm(z);
-      for (uint8_t i = 0; i < 2; i++) {
-	if (!done[i] && (n[i] >= 4)) {
-	  m->_draw_point(x[i], y[i], size[i], iter[i], z.get(i));
+    if (escaped || periodic || (n >= next_limit)) {
+      uint32_t refilled = 0;
+      for (unsigned i = 0; i < N; i++) {
+	uint32_t bit = 1U << i, iter = n - start[i] + from[i];
+	if (!(active & bit)) {
+	  // Subdivision may have queued more points since this lane ran dry
+	  if (tile.sub && tile.sub->queued) {
+	    reset_values(i);
+	    refilled |= bit;
+	  }
+	  continue;
+	}
+
+	// A point must be iterated at least once before it can escape or come back
+	if ((iter >= m->_iteration_limit) || ((escaped & bit) && (iter > 0))) {
+	  // Lanes are only checked for escaping after an iteration, so one that escaped right at the limit
+	  // can't be carried on from and starts again
+	  if ((iter >= m->_iteration_limit) && coords<T>::resumable) {
+	    if (escaped & bit)
+	      m->_save_orbit(x[i], y[i], NAN, NAN, 0);
+	    else
+	      m->_save_orbit(x[i], y[i], (double)z.real(i), (double)z.imag(i), 0);
+	  }
+	  m->_draw_point(x[i], y[i], size[i], job[i], iter, iter - from[i], z.get(i), counters);
+	  escapes_in_a_row = iter < m->_iteration_limit ? escapes_in_a_row + 1 : 0;
+
+	  reset_values(i);
+	  refilled |= bit;
+	} else if ((periodic & bit) && (iter > from[i])) {
+	  m->_draw_point(x[i], y[i], size[i], job[i], Mandelbrot::_count_mask, iter - from[i], z.get(i), counters);
+	  counters.periodic_saved += m->_iteration_limit - iter;
+	  escapes_in_a_row = 0;
 
 	  reset_values(i);
+	  refilled |= bit;
 	}
       }
+      reject_interior(refilled);
+      find_next_limit();
+      re2 = ops::mul(z.reals(), z.reals());
+      im2 = ops::mul(z.imags(), z.imags());
     }
+
+    vec ri = ops::mul(z.reals(), z.imags());
+    z = pack(ops::add(ops::sub(re2, im2), c.reals()),
+	     ops::add(ops::add(ri, ri), c.imags()));
+    n++;
   }
 
+  m->_thread_stopped();
   return 0;
 }
 
+int Mandelbrot_sp_thread(void* data) {
+  return Mandelbrot_simd_thread<float, simd_native<float>::lanes>((Mandelbrot*)data);
+}
+
+int Mandelbrot_ff_thread(void* data) {
+  return Mandelbrot_simd_thread<ffloat, simd_native<float>::lanes>((Mandelbrot*)data);
+}
+
 int Mandelbrot_dp_thread(void* data) {
-  Mandelbrot *m = (Mandelbrot*)data;
+  return Mandelbrot_simd_thread<double, simd_native<double>::lanes>((Mandelbrot*)data);
+}
 
-  uint32_t x, y, size;
-  std::complex<double> z, c;
-  uint32_t iter;
+int Mandelbrot_dd_thread(void* data) {
+  return Mandelbrot_simd_thread<ddouble, simd_native<double>::lanes>((Mandelbrot*)data);
+}
+
+// Quad-double is scalar, a point at a time
+int Mandelbrot_qd_thread(void* data) {
+  return Mandelbrot_simd_thread<qdouble, 1>((Mandelbrot*)data);
+}
+
+// Iterate N points at a time as deltas from the reference orbit at the centre of the window:
+//   z_n = Z_n + d_n, d_{n+1} = (2 Z_n + d_n) d_n + dc
+// When |z_n| < |d_n| the delta has lost precision against the reference (a "glitch"), so the point
+// is rebased onto the start of the reference by setting d = z and carrying on from Z_0.
+// The same happens when a point outlives a reference orbit that escaped.
+// Points start part way along the reference, using its series approximation to skip the iterations
+// where every point of the window still follows it closely.
+template <unsigned N>
+int Mandelbrot_perturbation_thread(Mandelbrot* m) {
+  typedef complexpack<double, N> pack;
+  typedef typename pack::ops ops;
+  typedef typename pack::vec vec;
+
+  uint32_t x[N], y[N], size[N];
+  Mandelbrot::Job *job[N];
+  pack d, dc;			// delta from the reference orbit, and of c from the reference's c
+  uint64_t n = 0, start[N], base[N];	// iterations done by the thread, when each lane was refilled and last rebased
+  uint32_t from[N];		// iterations each lane's point started with, skipped or done in earlier drawings
+  uint64_t next_event;		// when the next lane hits the iteration limit or the end of the reference
+  uint32_t active;		// bit mask of lanes with a point
   uint32_t restart_val;
+  Mandelbrot::Tile tile(0);
+  Mandelbrot::Counters counters(m->_next_thread++, N);
+  uint64_t counted_n = 0;	// n when the steps were last counted
+  std::shared_ptr<const Mandelbrot::Reference> ref;
+  uint64_t ref_end = 0;		// index of the last Z in the reference
 
-  auto reset_values = [m, &x, &y, &size, &z, &c, &iter](void) {
-    m->_get_coords(x, y, size);
-    std::complex<double> point(x - (m->_display->width() * 0.5),
-			       (m->_display->height() / m->_display->height()) * (y - (m->_display->height() * 0.5)));
-    point *= m->_pixel_size[m->_julia];
-    point += m->_centre[m->_julia];
-    if (m->_julia) {
-      // Julia set
-      z = point;
-      c = m->_centre[0];
-    } else {
-      // Mandelbrot set
-      z = 0;
-      c = point;
+  const vec four = ops::set1(4);
+
+  auto reset_values = [m, &tile, &x, &y, &size, &job, &d, &dc, &n, &start, &base, &from, &active, &ref, &counters](unsigned i) {
+    if (!m->_get_coords(tile, x[i], y[i], size[i], job[i], counters)) {
+      // Nothing left to draw, keep this lane following the reference
+      active &= ~(1U << i);
+      start[i] = base[i] = n;
+      from[i] = 0;
+      d.set(i, 0);
+      dc.set(i, 0);
+      return;
+    }
+    active |= 1U << i;
+
+    std::complex<double> offset(x[i] - (m->_canvas->width() * 0.5),
+				(m->_canvas->height() / m->_canvas->height()) * (y[i] - (m->_canvas->height() * 0.5)));
+    dc.set(i, offset * m->_drawing.pixel_size);
+
+    // Start the point as if it had already done the skipped iterations
+    std::complex<double> u = offset * (m->_drawing.pixel_size / ref->radius);
+    d.set(i, ((ref->c * u + ref->b) * u + ref->a) * u);
+    start[i] = base[i] = n - ref->skip;
+    from[i] = ref->skip;
+
+    // Or carry on from where the point stopped at a lower limit
+    double d_re, d_im;
+    uint32_t ref_index;
+    if (m->_resume_orbit(x[i], y[i], d_re, d_im, ref_index, from[i])) {
+      d.set(i, d_re, d_im);
+      start[i] = n - from[i];
+      base[i] = n - ref_index;
+    }
+  };
+
+  auto find_next_event = [m, &start, &base, &active, &next_event, &ref_end](void) {
+    next_event = UINT64_MAX;
+    for (unsigned i = 0; i < N; i++) {
+      if ((active & (1U << i)) && (start[i] + m->_iteration_limit < next_event))
+	next_event = start[i] + m->_iteration_limit;
+      if (base[i] + ref_end < next_event)
+	next_event = base[i] + ref_end;
     }
-    iter = 0;
   };
 
+  // Counted as working on a drawing from here until it's sleeping in _wait_for_restart() or shut down
+  m->_active_threads++;
+
  restart:
   restart_val = m->_restart_sem;
-  reset_values();
+  tile = Mandelbrot::Tile(restart_val, std::atomic_load(&m->_subdivision));
+  ref = std::atomic_load(&m->_reference);
+  active = 0;
+  if (ref) {
+    ref_end = ref->re.size() - 1;
+    for (unsigned i = 0; i < N; i++)
+      reset_values(i);
+    find_next_event();
+  }
 
-  while (!m->_shutdown) {
-    while (!m->_running && !m->_shutdown)
-      SDL_Delay(1);
-    if (m->_shutdown)
-      return 0;
+  // Checked every iteration, so only needs to be seen eventually; the restart reads them again in order
+  while (!m->_shutdown.load(std::memory_order_relaxed)) {
+    if (active == 0) {
+      // Finished our share of this drawing, wait for the next one
+      counters.steps += n - counted_n;
+      counted_n = n;
+      if (!m->_wait_for_restart(restart_val, counters))
+	return 0;
+      goto restart;
+    }
 
-    if (m->_restart_sem != restart_val)
+    if (m->_restart_sem.load(std::memory_order_relaxed) != restart_val)
       goto restart;
 
-    z = sqr(z) + c;
-    iter++;
+    vec ref_re, ref_im;
+    for (unsigned i = 0; i < N; i++) {
+      ops::set(ref_re, i, ref->re[n - base[i]]);
+      ops::set(ref_im, i, ref->im[n - base[i]]);
+    }
 
-    if ((iter >= m->_iteration_limit)
-	|| (z.real() < -2) || (z.real() > 2)
-	|| (z.imag() < -2) || (z.imag() > 2)
-	|| (norm(z) >= 4)) {
-      m->_draw_point(x, y, size, iter, z);
+    vec z_re = ops::add(ref_re, d.reals()), z_im = ops::add(ref_im, d.imags());
+    vec z_norm = ops::madd(z_im, z_im, ops::mul(z_re, z_re));
+    uint32_t escaped = ops::bits(ops::cmpge(z_norm, four)) & active;
+    uint32_t glitched = ops::bits(ops::mnot(ops::cmpge(z_norm, norm(d))));
 
-      reset_values();
+    if (escaped || glitched || (n >= next_event)) {
+      for (unsigned i = 0; i < N; i++) {
+	uint32_t bit = 1U << i, iter = n - start[i];
+	// Subdivision may have queued more points since this lane ran dry
+	if (!(active & bit) && tile.sub && tile.sub->queued) {
+	  reset_values(i);
+	  continue;
+	}
+
+	// A point must be iterated at least once before it can escape
+	if ((active & bit)
+	    && ((iter >= m->_iteration_limit) || ((escaped & bit) && (iter > 0)))) {
+	  std::complex<double> z(ops::get(z_re, i), ops::get(z_im, i));
+	  if (iter >= m->_iteration_limit)
+	    m->_save_orbit(x[i], y[i], d.real(i), d.imag(i), n - base[i]);
+	  m->_draw_point(x[i], y[i], size[i], job[i], iter, iter - from[i], z, counters);
+
+	  reset_values(i);
+	} else if ((glitched & bit) || (n - base[i] >= ref_end)) {
+	  if (active & bit) {
+	    d.set(i, ops::get(z_re, i), ops::get(z_im, i));
+	    counters.rebases++;
+	  } else
+	    d.set(i, 0);
+	  base[i] = n;
+	}
+      }
+      find_next_event();
+
+      // Lanes have changed, check them all again
+      continue;
     }
+
+    vec a_re = ops::add(ops::add(ref_re, ref_re), d.reals());
+    vec a_im = ops::add(ops::add(ref_im, ref_im), d.imags());
+    d = pack(a_re, a_im) * d + dc;
+    n++;
   }
 
+  m->_thread_stopped();
   return 0;
 }
+
+int Mandelbrot_pt_thread(void* data) {
+  return Mandelbrot_perturbation_thread<simd_native<double>::lanes>((Mandelbrot*)data);
+}
@@ -0,0 +1,121 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tilecache.hh"
+#include <algorithm>
+#include <cmath>
+
+const int32_t Tile_cache::tile_size;
+const uint32_t Tile_cache::empty;
+
+static bool same(const fixedcomplex& a, const fixedcomplex& b) {
+  return ((a.re - b.re).to_double() == 0) && ((a.im - b.im).to_double() == 0);
+}
+
+// Zooming out by a factor and back in again doesn't always round to the same pixel size
+static bool same_view(const Tile_cache::View& a, const Tile_cache::View& b) {
+  return (a.julia == b.julia) && (!a.julia || same(a.c, b.c))
+    && (std::abs(a.pixel_size - b.pixel_size) <= a.pixel_size * 1e-9)
+    && (a.limit == b.limit) && (a.precision == b.precision) && (a.perturbation == b.perturbation);
+}
+
+Tile_cache::Tile_cache(size_t max_bytes) :
+  _max_bytes(max_bytes), _next_grid(0)
+{}
+
+void Tile_cache::set_max_bytes(size_t max_bytes) {
+  _max_bytes = max_bytes;
+  while (bytes() > _max_bytes)
+    _drop_last();
+}
+
+void Tile_cache::clear(void) {
+  _index.clear();
+  _tiles.clear();
+  _grids.clear();
+}
+
+int32_t Tile_cache::grid(const View& view, const fixedcomplex& centre, int64_t& dx, int64_t& dy, bool add) {
+  if (_max_bytes < sizeof(Tile))
+    return -1;
+
+  // Windows line up with a grid when they are a whole number of its pixels from where it started
+  for (auto& g : _grids) {
+    if (!same_view(g.view, view))
+      continue;
+    double shift_x = (centre.re - g.centre.re).to_double() / g.view.pixel_size;
+    double shift_y = (centre.im - g.centre.im).to_double() / g.view.pixel_size;
+    if ((std::abs(shift_x) > 1e12) || (std::abs(shift_y) > 1e12))
+      continue;
+    dx = std::llround(shift_x);
+    dy = std::llround(shift_y);
+    if ((std::abs(shift_x - dx) < 1e-6) && (std::abs(shift_y - dy) < 1e-6))
+      return g.id;
+  }
+
+  if (!add)
+    return -1;
+
+  // Grids whose tiles have all been dropped are replaced, keeping the list short
+  _grids.erase(std::remove_if(_grids.begin(), _grids.end(), [](const Grid& g) { return g.tiles == 0; }), _grids.end());
+  _grids.push_back({ _next_grid++, view, centre, 0 });
+  dx = dy = 0;
+  return _grids.back().id;
+}
+
+Tile_cache::Tile* Tile_cache::find(int32_t grid, int64_t tx, int64_t ty) {
+  auto i = _index.find(Key(grid, tx, ty));
+  if (i == _index.end())
+    return nullptr;
+
+  _tiles.splice(_tiles.begin(), _tiles, i->second);
+  return &i->second->tile;
+}
+
+Tile_cache::Tile* Tile_cache::add(int32_t grid, int64_t tx, int64_t ty) {
+  Tile *t = find(grid, tx, ty);
+  if (t != nullptr)
+    return t;
+
+  while (!_tiles.empty() && (bytes() + sizeof(Tile) > _max_bytes))
+    _drop_last();
+
+  Key key(grid, tx, ty);
+  _tiles.emplace_front();
+  Entry &e = _tiles.front();
+  e.key = key;
+  std::fill(e.tile.iters, e.tile.iters + tile_size * tile_size, empty);
+  _index[key] = _tiles.begin();
+  for (auto& g : _grids)
+    if (g.id == grid)
+      g.tiles++;
+
+  return &e.tile;
+}
+
+void Tile_cache::_drop_last(void) {
+  if (_tiles.empty())
+    return;
+
+  int32_t grid = std::get<0>(_tiles.back().key);
+  for (auto& g : _grids)
+    if (g.id == grid)
+      g.tiles--;
+  _index.erase(_tiles.back().key);
+  _tiles.pop_back();
+}
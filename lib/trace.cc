@@ -0,0 +1,92 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.hh"
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+
+const uint32_t Trace::main_track;
+
+Trace::Trace(size_t max_events) :
+  _start(std::chrono::steady_clock::now()),
+  _max_events(max_events), _dropped(0)
+{
+  _events.reserve(std::min<size_t>(max_events, 1 << 12));
+  _tracks[main_track] = "main";
+}
+
+uint64_t Trace::now(void) const {
+  return at(std::chrono::steady_clock::now());
+}
+
+uint64_t Trace::at(std::chrono::steady_clock::time_point t) const {
+  if (t < _start)
+    return 0;
+  return std::chrono::duration_cast<std::chrono::microseconds>(t - _start).count();
+}
+
+void Trace::name_track(uint32_t track, const std::string& name) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _tracks[track] = name;
+}
+
+void Trace::add(uint32_t track, const char* name, uint64_t start, uint64_t end, const char* arg_name, int64_t arg) {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_events.size() >= _max_events) {
+    _dropped++;
+    return;
+  }
+  _events.push_back({ name, arg_name, track, start, end > start ? end - start : 0, arg });
+}
+
+uint64_t Trace::dropped(void) const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _dropped;
+}
+
+bool Trace::write(const char* filename) const {
+  FILE *fp = fopen(filename, "w");
+  if (fp == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> guard(_lock);
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  // Track names, sorted by their numbers
+  const char *sep = "";
+  for (auto& t : _tracks) {
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"%s\"}}",
+	    sep, t.first, t.second.c_str());
+    fprintf(fp, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"sort_index\":%" PRIu32 "}}",
+	    t.first, t.first);
+    sep = ",\n";
+  }
+
+  for (auto& e : _events) {
+    fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64,
+	    sep, e.name, e.track, e.start, e.duration);
+    if (e.arg_name != nullptr)
+      fprintf(fp, ",\"args\":{\"%s\":%" PRId64 "}", e.arg_name, e.arg);
+    fprintf(fp, "}");
+    sep = ",\n";
+  }
+
+  fprintf(fp, "\n]}\n");
+  return fclose(fp) == 0;
+}
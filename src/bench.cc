@@ -0,0 +1,294 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the iteration kernels over a fixed catalogue of views
+
+#include <chrono>
+#include <cmath>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "image.hh"
+#include "mandelbrot.hh"
+
+struct View {
+  const char *name;
+  bool julia;
+  double j_re, j_im;		// c for Julia sets
+  const char *c_re, *c_im;	// centre of the window, as strings for the deep views
+  double size;
+  uint32_t limit;
+};
+
+// A point near the seahorse valley spiral, given to 90 digits for the deep views
+#define DEEP_RE "-0.743643886953154152140070643823146721044437559440888872764822360141793106310176653258818057"
+#define DEEP_IM "0.131825904706608446973311684109067713283446481973573507165358031799164154202676731247212871"
+#define DEEP_LIMIT 8191
+
+// Don't change these without bumping the catalogue version, results would no longer be comparable
+#define CATALOGUE_VERSION 3
+const View views[] = {
+  { "full",             false, 0, 0,                          "-0.5", "0", 4.0,                                   1023 },
+  { "seahorse-valley",  false, 0, 0,                          "-0.7453", "0.1127", 0.01,                          1023 },
+  { "deep-minibrot",    false, 0, 0,                          "-0.7436441720129632", "0.13182539739503268", 5e-6, 4095 },
+  { "interior",         false, 0, 0,                          "-0.2", "0", 0.5,                                   1023 },
+  { "exterior",         false, 0, 0,                          "-0.5", "0", 16.0,                                  1023 },
+  { "julia-dendrite",   true,  0.0, 1.0,                      "0", "0", 4.0,                                      1023 },
+  { "julia-rabbit",     true,  -0.123, 0.745,                 "0", "0", 3.0,                                      1023 },
+  { "julia-san-marco",  true,  -0.75, 0.0,                    "0", "0", 3.5,                                      1023 },
+  { "julia-siegel",     true,  -0.390540870218, -0.586787907346, "0", "0", 3.0,                                 1023 },
+  { "deep-1e-30",       false, 0, 0,                          DEEP_RE, DEEP_IM, 1e-30,                            DEEP_LIMIT },
+  { "deep-1e-35",       false, 0, 0,                          DEEP_RE, DEEP_IM, 1e-35,                            DEEP_LIMIT },
+  { "julia-deep-1e-20", true,  0.0, 1.0,                      "0", "-1", 1e-20,                                   1023 },
+  { "julia-deep-1e-40", true,  0.0, 1.0,                      "0", "-1", 1e-40,                                   1023 },
+};
+
+// The perturbation kernel uses as many bits as the view needs
+const struct {
+  const char *name;
+  uint32_t prec;
+  bool perturbation;
+} kernels[] = {
+  { "32", 32,  false },
+  { "ff", 48,  false },
+  { "64", 64,  false },
+  { "dd", 128, false },
+  { "qd", 256, false },
+  { "pt", 0,   true },
+};
+
+void usage(const char* argv0) {
+  fprintf(stderr, "Usage: %s [options]\n", argv0);
+  fprintf(stderr, "  -r, --runs N         timed runs per case (default 5)\n");
+  fprintf(stderr, "  -t, --threads N      maximum number of threads (default: all CPUs)\n");
+  fprintf(stderr, "  -k, --kernel NAME    only run the 32, ff (float-float), 64-bit, dd (double-double),\n");
+  fprintf(stderr, "                       qd (quad-double) or pt (perturbation) kernel\n");
+  fprintf(stderr, "  -v, --view NAME      only run views whose name contains NAME\n");
+  fprintf(stderr, "  -S, --subdivide      draw with Mariani-Silver subdivision instead of progressive passes\n");
+  fprintf(stderr, "  -A, --affinity       pin each thread to a CPU of its own (Linux only)\n");
+  fprintf(stderr, "  -W, --width N        image width in pixels (default 960)\n");
+  fprintf(stderr, "  -H, --height N       image height in pixels (default 544)\n");
+  fprintf(stderr, "  -o, --output FILE    write CSV results to FILE instead of stdout\n");
+  fprintf(stderr, "  -l, --list           list the views and exit\n");
+}
+
+struct Result {
+  uint64_t iterations, periodic_saved, rejected, filled;
+  double mean, stddev, min, max;
+};
+
+// Set up a Mandelbrot for a view
+void setup_view(Mandelbrot& m, const View& v) {
+  if (v.julia) {
+    m.move(v.j_re, v.j_im, 4.0);
+    m.switch_type();
+  }
+  m.move(v.c_re, v.c_im, v.size);
+  m.set_limit(v.limit);
+}
+
+Result run_case(Image& img, const View& v, uint32_t prec, bool perturbation, bool subdivide, bool affinity,
+		uint32_t threads, uint32_t runs) {
+  Mandelbrot m(img);
+  m.force_precision(prec, perturbation);
+  m.set_threads(threads);
+  m.set_affinity(affinity);
+  m.set_subdivide(subdivide);
+  // Every run draws the same window, which must be iterated again rather than taken from the tile cache
+  m.set_cache_size(0);
+  setup_view(m, v);
+
+  Result r = { 0, 0, 0, 0, 0, 0, INFINITY, 0 };
+  std::vector<double> times;
+  // One extra untimed run to warm up the caches
+  for (uint32_t run = 0; run <= runs; run++) {
+    auto start = std::chrono::steady_clock::now();
+    m.reset();
+    m.start_threads();
+    m.wait();
+    auto end = std::chrono::steady_clock::now();
+    m.stop_threads();
+
+    if (run == 0)
+      continue;
+
+    double t = std::chrono::duration<double>(end - start).count();
+    times.push_back(t);
+    r.mean += t;
+    r.min = std::min(r.min, t);
+    r.max = std::max(r.max, t);
+    r.iterations = m.iterations();
+    r.periodic_saved = m.periodic_saved();
+    r.rejected = m.rejected();
+    r.filled = m.filled();
+  }
+
+  r.mean /= runs;
+  for (auto t : times)
+    r.stddev += sqr(t - r.mean);
+  r.stddev = runs > 1 ? sqrt(r.stddev / (runs - 1)) : 0;
+
+  return r;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t runs = 5, max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  const char *only_kernel = nullptr, *only_view = nullptr;
+  int32_t width = 960, height = 544;
+  bool subdivide = false, affinity = false;
+  FILE *out = stdout;
+
+  static const struct option long_options[] = {
+    { "runs",    required_argument, nullptr, 'r' },
+    { "threads", required_argument, nullptr, 't' },
+    { "kernel",  required_argument, nullptr, 'k' },
+    { "view",    required_argument, nullptr, 'v' },
+    { "subdivide", no_argument,     nullptr, 'S' },
+    { "affinity", no_argument,      nullptr, 'A' },
+    { "width",   required_argument, nullptr, 'W' },
+    { "height",  required_argument, nullptr, 'H' },
+    { "output",  required_argument, nullptr, 'o' },
+    { "list",    no_argument,       nullptr, 'l' },
+    { "help",    no_argument,       nullptr, 'h' },
+    { nullptr,   0,                 nullptr, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "r:t:k:v:SAW:H:o:lh", long_options, nullptr)) != -1) {
+    switch (opt) {
+    case 'r':
+      runs = strtoul(optarg, nullptr, 10);
+      break;
+
+    case 't':
+      max_threads = strtoul(optarg, nullptr, 10);
+      break;
+
+    case 'k':
+      only_kernel = optarg;
+      break;
+
+    case 'v':
+      only_view = optarg;
+      break;
+
+    case 'S':
+      subdivide = true;
+      break;
+
+    case 'A':
+      affinity = true;
+      break;
+
+    case 'W':
+      width = atoi(optarg);
+      break;
+
+    case 'H':
+      height = atoi(optarg);
+      break;
+
+    case 'o':
+      out = fopen(optarg, "w");
+      if (out == nullptr) {
+	perror(optarg);
+	return 1;
+      }
+      break;
+
+    case 'l':
+      for (auto& v : views)
+	printf("%s\n", v.name);
+      return 0;
+
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if ((runs == 0) || (max_threads == 0) || (width <= 0) || (height <= 0)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // 1, 2, 4... up to the maximum
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t t = 1; t < max_threads; t <<= 1)
+    thread_counts.push_back(t);
+  thread_counts.push_back(max_threads);
+
+  Image img(width, height);
+  uint64_t pixels = (uint64_t)width * height;
+
+  fprintf(out, "# vitabrot-bench catalogue %d, %dx%d, %u runs%s%s\n", CATALOGUE_VERSION, width, height, runs,
+	  subdivide ? ", subdivision" : "", affinity ? ", pinned threads" : "");
+  fprintf(out, "view,kernel,threads,pixels,iterations,mean_s,stddev_s,min_s,max_s,pixels_per_s,iterations_per_s,iterations_per_s_per_thread,speedup,periodic_saved,rejected,filled\n");
+
+  for (auto& v : views) {
+    if ((only_view != nullptr) && (strstr(v.name, only_view) == nullptr))
+      continue;
+
+    // The precision the view would be drawn with
+    Mandelbrot view_m(img);
+    setup_view(view_m, v);
+    uint32_t view_prec = view_m.precision();
+    bool view_perturbation = view_m.perturbation();
+
+    for (auto& k : kernels) {
+      if ((only_kernel != nullptr) && (strcmp(k.name, only_kernel) != 0))
+	continue;
+      // Don't time kernels that can't draw the view, and there's no perturbation for Julia sets
+      if (!k.perturbation && (view_perturbation || ((k.prec < view_prec) && (k.prec != 48))))
+	continue;
+      if (v.julia && k.perturbation)
+	continue;
+      // The extended precision kernels are too slow to bother with where doubles will do,
+      // but float-float is compared against doubles on the views that need them
+      if ((k.prec > 64) && (view_prec <= 64))
+	continue;
+      if ((k.prec == 48) && ((view_prec < 48) || (view_prec > 64)))
+	continue;
+
+      double base = 0;
+      for (auto threads : thread_counts) {
+	fprintf(stderr, "%s, %s kernel, %u thread%s...\n", v.name, k.name, threads, threads > 1 ? "s" : "");
+	Result r = run_case(img, v, k.prec, k.perturbation, subdivide, affinity, threads, runs);
+	if (threads == 1)
+	  base = r.mean;
+
+	double ips = r.iterations / r.mean;
+	fprintf(out, "%s,%s,%u,%llu,%llu,%.6f,%.6f,%.6f,%.6f,%.0f,%.0f,%.0f,%.3f,%llu,%llu,%llu\n",
+		v.name, k.name, threads, (unsigned long long)pixels, (unsigned long long)r.iterations,
+		r.mean, r.stddev, r.min, r.max,
+		pixels / r.mean, ips, ips / threads,
+		base / r.mean, (unsigned long long)r.periodic_saved, (unsigned long long)r.rejected,
+		(unsigned long long)r.filled);
+	fflush(out);
+      }
+    }
+  }
+
+  if (out != stdout)
+    fclose(out);
+
+  return 0;
+}
@@ -39,6 +39,35 @@ enum joystick_buttons {
   VITA_NUM_BUTTONS
 };
 
+// One record per thread and per pass of a finished drawing, for working out why a view is slow
+static void log_stats(const Mandelbrot& m, uint32_t drawing) {
+  char line[256];
+  std::vector<Mandelbrot::Thread_stats> threads = m.thread_stats();
+  for (size_t t = 0; t < threads.size(); t++) {
+    const Mandelbrot::Thread_stats &ts = threads[t];
+    snprintf(line, sizeof(line), "drawing=%lu thread=%u lanes=%lu iterations=%llu steps=%llu pixels=%llu escaped=%llu "
+	     "unresolved=%llu inside=%llu idle_us=%llu lock_wait_us=%llu\n",
+	     (unsigned long)drawing, (unsigned)t, (unsigned long)ts.lanes, (unsigned long long)ts.iterations,
+	     (unsigned long long)ts.steps, (unsigned long long)ts.pixels, (unsigned long long)ts.escaped,
+	     (unsigned long long)ts.unresolved, (unsigned long long)ts.inside, (unsigned long long)ts.idle_us,
+	     (unsigned long long)ts.lock_wait_us);
+    DEBUG_LOG(line);
+  }
+
+  if (m.cached_pixels() > 0) {
+    snprintf(line, sizeof(line), "drawing=%lu cached=%lu\n", (unsigned long)drawing, (unsigned long)m.cached_pixels());
+    DEBUG_LOG(line);
+  }
+
+  std::vector<Mandelbrot::Pass_stats> passes = m.pass_stats();
+  for (size_t p = passes.size(); p-- > 0;)
+    if (passes[p].pixels > 0) {
+      snprintf(line, sizeof(line), "drawing=%lu pass=%u pixels=%llu iterations=%llu\n", (unsigned long)drawing, (unsigned)p,
+	       (unsigned long long)passes[p].pixels, (unsigned long long)passes[p].iterations);
+      DEBUG_LOG(line);
+    }
+}
+
 int main(int argc, char *argv[]) {
   log_open("ux0:data/vitabrot.log");
   Display disp;
@@ -63,21 +92,52 @@ int main(int argc, char *argv[]) {
   scePowerSetGpuXbarClockFrequency(166);
   scePowerSetGpuClockFrequency(333);
 
+  // Built with VITABROT_TRACE, everything the threads did is written out as a Chrome trace on exit
+  Trace *trace = nullptr;
+#ifdef VITABROT_TRACE
+  Trace full_trace;
+  trace = &full_trace;
+#endif
+
   Mandelbrot m(disp);
+  m.set_trace(trace);
   m.move(-0.5, 0.0, 4.0);
-  m.reset();
+  // The limit first, the tile cache keeps the drawing under the one it had when reset() was called
   m.set_limit(1023);
+  m.reset();
 
+  // All four cores, whatever the runtime says about them
+  m.set_threads(4);
   m.start_threads();
 
   bool buttons[VITA_NUM_BUTTONS];
   for (uint8_t i = 0; i < VITA_NUM_BUTTONS; i++)
     buttons[i] = false;
 
-  uint32_t last_switch = 0, last_move = 0;
+  uint32_t last_switch = 0, last_colouring = 0, last_move = 0;
+  bool auto_limit = true;
+
+  // From a press that moves the view until a frame showing new pixels for it is on the screen
+  Latency_histogram input_latency;
+  uint32_t input_ticks = 0;	// when the input being drawn came in, 0 once shown
+  uint32_t pressed = 0;		// when the first button press not yet acted on came in
+
+  uint32_t drawing = 0;		// number of the current drawing, for the stats records
+  bool logged = false;
+  bool limit_checked = false;	// adapt_limit() has looked at the current drawing, once it finished
+
   bool running = true;
   while (running) {
+    bool new_pixels = (input_ticks != 0) && m.pixels_drawn();
+    uint32_t last_refresh = disp.Last_refresh();
+    uint64_t refresh_start = trace ? trace->now() : 0;
     disp.Refresh();
+    if (trace && (disp.Last_refresh() != last_refresh))
+      trace->add(Trace::main_track, "present", refresh_start, trace->now());
+    if (new_pixels && (disp.Last_refresh() != last_refresh)) {
+      input_latency.add((disp.Last_refresh() - input_ticks) * 1000ULL);
+      input_ticks = 0;
+    }
 
     bool changed = false;
     SDL_Event ev;
@@ -89,6 +149,8 @@ int main(int argc, char *argv[]) {
 
       case SDL_JOYBUTTONDOWN:
 	buttons[ev.jbutton.button] = true;
+	if (pressed == 0)
+	  pressed = ev.jbutton.timestamp;
 	break;
 
       case SDL_JOYBUTTONUP:
@@ -110,10 +172,54 @@ int main(int argc, char *argv[]) {
       last_switch = SDL_GetTicks();
     }
 
-    // Limit rate of moving/zooming to 10 Hz
+    if (buttons[VITA_START] && (SDL_GetTicks() > last_switch + 400)) {
+      auto_limit = !auto_limit;
+      limit_checked = false;
+      last_switch = SDL_GetTicks();
+    }
+
+    if (!logged && m.finished()) {
+      log_stats(m, drawing);
+      logged = true;
+    }
+
+    // Once a drawing is finished, see if the limit is too low or high for it
+    // Raising it only iterates the points that reached the old limit further
+    // Looking goes over every pixel, so it's only done once for each drawing
+    if (auto_limit && !limit_checked && m.finished()) {
+      limit_checked = true;
+      if (m.adapt_limit()) {
+	m.reset();
+	drawing++;
+	logged = false;
+	limit_checked = false;
+      }
+    }
+
+    // Changing the colouring only recolours what has been drawn already
+    if ((buttons[VITA_CROSS] || buttons[VITA_SELECT]) && (SDL_GetTicks() > last_colouring + 400)) {
+      Mandelbrot::Colouring c = m.colouring();
+      if (buttons[VITA_CROSS])
+	c.smooth = !c.smooth;
+      if (buttons[VITA_SELECT])
+	c.interior = !c.interior;
+      m.set_colouring(c);
+      m.recolour();
+      last_colouring = SDL_GetTicks();
+    }
+
+    // Limit rate of moving/zooming and colour cycling to 10 Hz
     if (SDL_GetTicks() < last_move + 100)
       continue;
 
+    if (buttons[VITA_TRIANGLE]) {
+      Mandelbrot::Colouring c = m.colouring();
+      c.offset++;
+      m.set_colouring(c);
+      m.recolour();
+      last_move = SDL_GetTicks();
+    }
+
     if (buttons[VITA_UP]) {
       m.move_rel(0, -0.01);
       changed = true;
@@ -146,11 +252,31 @@ int main(int argc, char *argv[]) {
 
     if (changed) {
       last_move = SDL_GetTicks();
+      // A button held down asks again every time it's acted on
+      if (input_ticks == 0)
+	input_ticks = pressed ? pressed : last_move;
       m.reset();
+      drawing++;
+      logged = false;
+      limit_checked = false;
     }
+    pressed = 0;
   }
 
   m.stop_threads();
+  if (trace)
+    trace->write("ux0:data/vitabrot-trace.json");
+
+  const Mandelbrot::Latency &latency = m.latency();
+  DEBUG_LOG(input_latency.summary("input to screen").c_str());
+  DEBUG_LOG(latency.restart.summary("restart").c_str());
+  DEBUG_LOG(latency.first_pixel.summary("first pixel").c_str());
+  for (size_t p = latency.passes.size() - 1; p > 0; p--) {
+    char name[16];
+    snprintf(name, sizeof(name), "pass %u", (unsigned)p);
+    DEBUG_LOG(latency.passes[p].summary(name).c_str());
+  }
+  DEBUG_LOG(latency.finished.summary("finished").c_str());
 
   // Restore clock frequencies
   scePowerSetArmClockFrequency(old_armclock);
@@ -0,0 +1,395 @@
+/*
+  VitaBrot, Mandelbrot explorer for the Playstation Vita.
+  Copyright (C) 2017 Ian Tester
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Headless renderer, for running the Mandelbrot core on a host without a window
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "image.hh"
+#include "mandelbrot.hh"
+
+void usage(const char* argv0) {
+  fprintf(stderr, "Usage: %s [options]\n", argv0);
+  fprintf(stderr, "  -c, --centre RE,IM   centre of the window (default -0.5,0, or 0,0 with -j)\n");
+  fprintf(stderr, "  -s, --size SIZE      width of the window in the complex plane (default 4)\n");
+  fprintf(stderr, "  -l, --limit N        iteration limit (default 1023)\n");
+  fprintf(stderr, "  -a, --auto-limit F   raise or lower the limit from -l until at most a fraction F of the pixels\n");
+  fprintf(stderr, "                       are on the boundary but still unresolved (e.g. 0.001)\n");
+  fprintf(stderr, "  -j, --julia RE,IM    draw the Julia set for c = RE + IMi\n");
+  fprintf(stderr, "  -W, --width N        image width in pixels (default 960)\n");
+  fprintf(stderr, "  -H, --height N       image height in pixels (default 544)\n");
+  fprintf(stderr, "  -t, --threads N      number of threads (default: one per CPU)\n");
+  fprintf(stderr, "  -A, --affinity       pin each thread to a CPU of its own (Linux only)\n");
+  fprintf(stderr, "  -S, --subdivide      draw with Mariani-Silver subdivision instead of progressive passes\n");
+  fprintf(stderr, "      --smooth         blend the colours between iteration counts\n");
+  fprintf(stderr, "      --cycle N        rotate the palette by N entries\n");
+  fprintf(stderr, "      --interior       colour the inside of the set by its final |z|\n");
+  fprintf(stderr, "  -T, --trace FILE     write a timeline of the threads, drawings and passes as a Chrome trace\n");
+  fprintf(stderr, "      --cost FILE      write what each pixel cost as a PPM: escaped and unresolved pixels from black through\n");
+  fprintf(stderr, "                       red and yellow to white by their iterations on a log scale, periodic ones in green,\n");
+  fprintf(stderr, "                       the cardioid and bulbs in blue and subdivision's filled rectangles in grey\n");
+  fprintf(stderr, "      --cost-csv FILE  write x,y,iterations,source,precision,perturbation for every pixel\n");
+  fprintf(stderr, "  -o, --output FILE    output PPM file (default vitabrot.ppm)\n");
+}
+
+static const char* source_names[] = { "none", "filled", "rejected", "periodic", "escaped", "unresolved" };
+
+// Brightness from the iterations on a log scale, hue from how the pixel was drawn
+Colour cost_colour(const Mandelbrot::Pixel_cost& cost, double log_max) {
+  double t = log_max > 0 ? std::log2(1.0 + cost.iterations) / log_max : 0;
+  auto level = [](double v) { return (uint8_t)std::lround(std::min(std::max(v, 0.0), 1.0) * 255); };
+  switch (cost.source) {
+  case Mandelbrot::Pixel_source::filled:
+    return Colour{ 64, 64, 64, 255 };
+  case Mandelbrot::Pixel_source::rejected:
+    return Colour{ 0, 0, 160, 255 };
+  case Mandelbrot::Pixel_source::periodic:
+    return Colour{ 0, level(0.25 + 0.75 * t), 0, 255 };
+  case Mandelbrot::Pixel_source::escaped:
+  case Mandelbrot::Pixel_source::unresolved:
+    return Colour{ level(3 * t), level(3 * t - 1), level(3 * t - 2), 255 };
+  default:
+    return Colour{ 0, 0, 0, 255 };
+  }
+}
+
+bool write_cost(const char* filename, const std::vector<Mandelbrot::Pixel_cost>& costs, int32_t width, int32_t height) {
+  uint32_t max = 0;
+  for (auto& cost : costs)
+    max = std::max(max, cost.iterations);
+  double log_max = std::log2(1.0 + max);
+
+  Image img(width, height);
+  for (int32_t y = 0; y < height; y++)
+    for (int32_t x = 0; x < width; x++) {
+      Colour col = cost_colour(costs[y * width + x], log_max);
+      img.Draw_pixel(x, y, 1, col.r, col.g, col.b, col.a);
+    }
+  return img.Write_PPM(filename);
+}
+
+bool write_cost_csv(const char* filename, const std::vector<Mandelbrot::Pixel_cost>& costs, int32_t width, int32_t height) {
+  FILE *fp = fopen(filename, "w");
+  if (fp == nullptr)
+    return false;
+
+  fprintf(fp, "x,y,iterations,source,precision,perturbation\n");
+  for (int32_t y = 0; y < height; y++)
+    for (int32_t x = 0; x < width; x++) {
+      const Mandelbrot::Pixel_cost &cost = costs[y * width + x];
+      fprintf(fp, "%d,%d,%u,%s,%u,%d\n", x, y, cost.iterations, source_names[(int)cost.source],
+	      cost.precision, cost.perturbation ? 1 : 0);
+    }
+  return fclose(fp) == 0;
+}
+
+bool parse_complex(const char* arg, double& re, double& im) {
+  return sscanf(arg, "%lf,%lf", &re, &im) == 2;
+}
+
+// Keep the centre as strings, doubles don't have enough digits for deep zooms
+bool parse_complex(const char* arg, std::string& re, std::string& im) {
+  const char *comma = strchr(arg, ',');
+  if (comma == nullptr)
+    return false;
+  re = std::string(arg, comma - arg);
+  im = std::string(comma + 1);
+  return fixedpoint::valid(re) && fixedpoint::valid(im);
+}
+
+int main(int argc, char *argv[]) {
+  std::string c_re, c_im;	// empty for the default of the set being drawn
+  double size = 4.0;
+  double j_re = 0.0, j_im = 0.0;
+  bool julia = false;
+  uint32_t limit = 1023;
+  double auto_limit = 0;
+  int32_t width = 960, height = 544;
+  uint32_t threads = 0;		// one per CPU
+  bool subdivide = false, affinity = false;
+  Mandelbrot::Colouring colouring;
+  const char *output = "vitabrot.ppm";
+  const char *trace_file = nullptr;
+  const char *cost_file = nullptr, *cost_csv_file = nullptr;
+
+  static const struct option long_options[] = {
+    { "centre", required_argument, nullptr, 'c' },
+    { "size",   required_argument, nullptr, 's' },
+    { "limit",  required_argument, nullptr, 'l' },
+    { "auto-limit", required_argument, nullptr, 'a' },
+    { "julia",  required_argument, nullptr, 'j' },
+    { "width",  required_argument, nullptr, 'W' },
+    { "height", required_argument, nullptr, 'H' },
+    { "threads", required_argument, nullptr, 't' },
+    { "affinity", no_argument,     nullptr, 'A' },
+    { "subdivide", no_argument,    nullptr, 'S' },
+    { "smooth", no_argument,       nullptr, 'm' },
+    { "cycle",  required_argument, nullptr, 'y' },
+    { "interior", no_argument,     nullptr, 'i' },
+    { "trace",  required_argument, nullptr, 'T' },
+    { "cost",   required_argument, nullptr, 'k' },
+    { "cost-csv", required_argument, nullptr, 'K' },
+    { "output", required_argument, nullptr, 'o' },
+    { "help",   no_argument,       nullptr, 'h' },
+    { nullptr,  0,                 nullptr, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:s:l:a:j:W:H:t:AST:o:h", long_options, nullptr)) != -1) {
+    switch (opt) {
+    case 'c':
+      if (!parse_complex(optarg, c_re, c_im)) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+
+    case 's':
+      size = atof(optarg);
+      break;
+
+    case 'l':
+      limit = strtoul(optarg, nullptr, 10);
+      break;
+
+    case 'a':
+      auto_limit = atof(optarg);
+      break;
+
+    case 'j':
+      if (!parse_complex(optarg, j_re, j_im)) {
+	usage(argv[0]);
+	return 1;
+      }
+      julia = true;
+      break;
+
+    case 'W':
+      width = atoi(optarg);
+      break;
+
+    case 'H':
+      height = atoi(optarg);
+      break;
+
+    case 't':
+      threads = strtoul(optarg, nullptr, 10);
+      if (threads == 0) {
+	usage(argv[0]);
+	return 1;
+      }
+      break;
+
+    case 'A':
+      affinity = true;
+      break;
+
+    case 'S':
+      subdivide = true;
+      break;
+
+    case 'm':
+      colouring.smooth = true;
+      break;
+
+    case 'y':
+      colouring.offset = strtoul(optarg, nullptr, 10);
+      break;
+
+    case 'i':
+      colouring.interior = true;
+      break;
+
+    case 'T':
+      trace_file = optarg;
+      break;
+
+    case 'k':
+      cost_file = optarg;
+      break;
+
+    case 'K':
+      cost_csv_file = optarg;
+      break;
+
+    case 'o':
+      output = optarg;
+      break;
+
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if ((width <= 0) || (height <= 0) || (size <= 0) || (limit < Mandelbrot::min_limit) || (limit > Mandelbrot::max_limit) || (auto_limit < 0)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Julia sets are centred on 0, the Mandelbrot set a little to the left
+  if (c_re.empty()) {
+    c_re = julia ? "0" : "-0.5";
+    c_im = "0";
+  }
+
+  Trace trace;
+  Image img(width, height);
+  Mandelbrot m(img);
+  if (trace_file != nullptr)
+    m.set_trace(&trace);
+  if (julia) {
+    m.move(j_re, j_im, 4.0);
+    m.switch_type();
+  }
+  m.move(c_re, c_im, size);
+  m.set_limit(limit);
+  if (threads > 0)
+    m.set_threads(threads);
+  m.set_affinity(affinity);
+  m.set_subdivide(subdivide);
+  m.set_colouring(colouring);
+  m.set_cost_map((cost_file != nullptr) || (cost_csv_file != nullptr));
+  if (auto_limit > 0)
+    m.set_auto_limit(auto_limit, 255, 1 << 20);
+
+  auto start = std::chrono::steady_clock::now();
+  m.reset();
+  m.start_threads();
+  m.wait();
+  uint64_t iterations = m.iterations();
+  // Each new limit only iterates further the pixels that reached the last one
+  while ((auto_limit > 0) && m.adapt_limit()) {
+    m.reset();
+    m.wait();
+    iterations += m.iterations();
+  }
+  auto end = std::chrono::steady_clock::now();
+  m.stop_threads();
+
+  // Colouring again is a pass over the kept counts, without iterating
+  auto recolour_start = std::chrono::steady_clock::now();
+  m.recolour();
+  double recolour_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - recolour_start).count();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  uint64_t pixels = (uint64_t)width * height;
+  const char *kind = "";
+  if (m.perturbation())
+    kind = " (perturbation)";
+  else if (m.precision() == 128)
+    kind = " (double-double)";
+  else if (m.precision() == 256)
+    kind = " (quad-double)";
+  printf("precision:    %u bits%s\n", m.precision(), kind);
+  printf("wall time:    %.6f s\n", seconds);
+  printf("pixels/s:     %.0f\n", pixels / seconds);
+  printf("iterations:   %llu\n", (unsigned long long)iterations);
+  printf("iterations/s: %.0f\n", iterations / seconds);
+  printf("periodicity:  %llu iterations saved\n", (unsigned long long)m.periodic_saved());
+  printf("rejected:     %llu points inside the cardioid or bulbs\n", (unsigned long long)m.rejected());
+  if (auto_limit > 0) {
+    const Mandelbrot::Escape_stats &stats = m.escape_stats();
+    printf("limit:        %u, %llu pixels unresolved, %llu escaped in the top octave, highest count %u\n",
+	   m.limit(), (unsigned long long)stats.unresolved, (unsigned long long)stats.top_octave, stats.max_escape);
+  }
+  printf("recolour:     %.6f s\n", recolour_seconds);
+
+  // How soon after reset() the drawing showed something, and had each of its coarse passes complete
+  const Mandelbrot::Latency &latency = m.latency();
+  std::vector<Mandelbrot::Pass_stats> passes = m.pass_stats();
+  printf("first pixel:  %.6f s\n", latency.first_pixel.mean() / 1e6);
+  for (size_t p = passes.size(); p-- > 0;) {
+    if (passes[p].pixels == 0)
+      continue;
+    printf("pass %zu:       %llu pixels, %llu iterations", p,
+	   (unsigned long long)passes[p].pixels, (unsigned long long)passes[p].iterations);
+    if ((p > 0) && (latency.passes[p].count() > 0))
+      printf(", complete after %.6f s", latency.passes[p].mean() / 1e6);
+    printf("\n");
+  }
+
+  // How the work was shared out, and how much of it filled the SIMD lanes
+  std::vector<Mandelbrot::Thread_stats> thread_stats = m.thread_stats();
+  for (size_t t = 0; t < thread_stats.size(); t++) {
+    const Mandelbrot::Thread_stats &ts = thread_stats[t];
+    double busy = ts.steps ? (double)ts.iterations / ((double)ts.steps * ts.lanes) : 0;
+    printf("thread %zu:     %llu pixels (%llu escaped, %llu unresolved, %llu inside), %.0f%% of lanes busy, "
+	   "idle %.3f ms, waited %.3f ms for the lock\n", t,
+	   (unsigned long long)ts.pixels, (unsigned long long)ts.escaped, (unsigned long long)ts.unresolved,
+	   (unsigned long long)ts.inside, busy * 100, ts.idle_us / 1000.0, ts.lock_wait_us / 1000.0);
+  }
+  if (m.subdivide())
+    printf("filled:       %llu pixels\n", (unsigned long long)m.filled());
+  if (m.perturbation()) {
+    printf("rebases:      %llu\n", (unsigned long long)m.rebases());
+    printf("series skip:  %u iterations\n", m.series_skip());
+  }
+
+  // Where the iterations went, by how the pixels were drawn
+  const std::vector<Mandelbrot::Pixel_cost> &costs = m.cost_map();
+  if (!costs.empty()) {
+    const size_t num_sources = sizeof(source_names) / sizeof(source_names[0]);
+    uint64_t source_pixels[num_sources] = {}, source_iterations[num_sources] = {}, total = 0;
+    uint32_t max = 0;
+    for (auto& cost : costs) {
+      source_pixels[(int)cost.source]++;
+      source_iterations[(int)cost.source] += cost.iterations;
+      total += cost.iterations;
+      max = std::max(max, cost.iterations);
+    }
+    for (size_t s = 1; s < num_sources; s++)
+      if (source_pixels[s] > 0)
+	printf("cost %-12s %llu pixels, %llu iterations (%.1f%%)\n", (std::string(source_names[s]) + ":").c_str(),
+	       (unsigned long long)source_pixels[s], (unsigned long long)source_iterations[s],
+	       total ? source_iterations[s] * 100.0 / total : 0.0);
+    printf("cost max:         %u iterations\n", max);
+
+    if ((cost_file != nullptr) && !write_cost(cost_file, costs, width, height)) {
+      perror(cost_file);
+      return 1;
+    }
+    if ((cost_csv_file != nullptr) && !write_cost_csv(cost_csv_file, costs, width, height)) {
+      perror(cost_csv_file);
+      return 1;
+    }
+  }
+
+  if (!img.Write_PPM(output)) {
+    perror(output);
+    return 1;
+  }
+
+  if (trace_file != nullptr) {
+    if (!trace.write(trace_file)) {
+      perror(trace_file);
+      return 1;
+    }
+    if (trace.dropped() > 0)
+      fprintf(stderr, "%s: %llu events didn't fit\n", trace_file, (unsigned long long)trace.dropped());
+  }
+
+  return 0;
+}